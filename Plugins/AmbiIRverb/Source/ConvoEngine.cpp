@@ -1,180 +1,680 @@
 #include "ConvoEngine.h"
 
 IRConvolutionEngine::IRConvolutionEngine()
+: juce::Thread("AmbiGlass IR Loader")
 {
     params.timeScale = 1.0f;
-    currentTimeScale = 1.0f;
     irInfo = "No IR loaded";
+    startThread(juce::Thread::Priority::low);
+}
+
+IRConvolutionEngine::~IRConvolutionEngine()
+{
+    stopThread(2000);
+    delete pendingConvolver.exchange(nullptr);
+    delete retiredConvolver.exchange(nullptr);
 }
 
 void IRConvolutionEngine::prepare(const juce::dsp::ProcessSpec& spec)
 {
+    // The audio thread is stopped here, so the active convolver is replaced directly
+    const juce::ScopedLock sourceLock(irSourceLock);
     this->spec = spec;
+    {
+        const juce::ScopedLock rl(requestLock);
+        lowLatency = requestedLowLatency;
+        backgroundTail = requestedBackgroundTail;
+        hybridTail = requestedHybridTail;
+    }
+    
+    // Crossfade scratch, one channel per bus channel
+    fadeBuffer.setSize(juce::jmax(2, static_cast<int>(spec.numChannels)), static_cast<int>(spec.maximumBlockSize));
+    fadeLength = juce::jmax(1, static_cast<int>(spec.sampleRate * crossfadeSeconds));
     
-    conv.prepare(spec);
-    convLL.prepare(spec);
-    convLR.prepare(spec);
-    convRL.prepare(spec);
-    convRR.prepare(spec);
+    delete pendingConvolver.exchange(nullptr);
+    delete retiredConvolver.exchange(nullptr);
+    fadingConvolver.reset();
+    
+    // Rebuild the partitions for the new block size/sample rate. A build the loader
+    // thread is running for the old spec is dropped when it finishes.
+    ++buildGeneration;
+    builtTimeScale = requestedTimeScale.load(std::memory_order_relaxed);
+    const auto settings = getBuildSettings();
+    convolver = irHash.isNotEmpty() ? createConvolver(settings) : nullptr;
+    activeLatency.store(convolver != nullptr ? convolver->getLatencySamples() : 0);
+    activeMemory.store(convolver != nullptr ? convolver->getMemorySamples() : 0);
+    activeDecay.store(convolver != nullptr ? convolver->getDecaySamples() : 0);
+    if (convolver != nullptr) {
+        const auto info = describeTrim(settings, *convolver);
+        const juce::ScopedLock rl(requestLock);
+        irInfo = info;
+    }
 }
 
 void IRConvolutionEngine::reset()
 {
-    conv.reset();
-    convLL.reset();
-    convLR.reset();
-    convRL.reset();
-    convRR.reset();
+    if (convolver != nullptr)
+        convolver->reset();
+    if (fadingConvolver != nullptr)
+        fadingConvolver->reset();
+}
+
+IRFormat IRConvolutionEngine::detectIRFormat(const juce::AudioFormatReader& reader, const juce::File& file)
+{
+    // Channel counts other than 1, 2 and 4 are rejected before this
+    if (reader.numChannels == 1) return IRFormat::Mono;
+    if (reader.numChannels == 2) return IRFormat::Stereo;
+    const auto name = file.getFileName();
+    if (file.hasFileExtension("amb") || name.containsIgnoreCase("FOA") || name.containsIgnoreCase("AmbiX"))
+        return IRFormat::FOA;
+    return IRFormat::TrueStereo;
 }
 
-IRFormat IRConvolutionEngine::detectIRFormat(juce::AudioFormatReader* reader)
+// Two virtual cardioids at +-45 degrees from the B-format response (AmbiX W, Y, Z, X;
+// SN3D, so W is the omni at unit gain). Height (Z) is dropped.
+static void decodeFOAToStereo(juce::AudioBuffer<float>& ir)
 {
-    if (reader == nullptr) return IRFormat::Stereo;
+    const int numSamples = ir.getNumSamples();
+    juce::AudioBuffer<float> stereo(2, numSamples);
+    const float* w = ir.getReadPointer(0);
+    const float* y = ir.getReadPointer(1);
+    const float* x = ir.getReadPointer(3);
+    float* left = stereo.getWritePointer(0);
+    float* right = stereo.getWritePointer(1);
+    const float side = std::sqrt(0.5f);
+    for (int i = 0; i < numSamples; ++i) {
+        left[i] = 0.5f * (w[i] + side * (x[i] + y[i]));
+        right[i] = 0.5f * (w[i] + side * (x[i] - y[i]));
+    }
+    ir = std::move(stereo);
+}
+
+// Band-limited resampling with a Blackman-windowed sinc. The cutoff sits just below
+// the lower of the two Nyquist frequencies, so downsampling (a 96 kHz IR in a 48 kHz
+// session, or Time below 1) filters out what would alias instead of folding it back.
+// Runs in chunks so a build can be abandoned; false if the calling thread was asked to exit
+static bool resampleIR(juce::AudioBuffer<float>& ir, double sourceRate, double targetRate)
+{
+    if (sourceRate <= 0.0 || targetRate <= 0.0 || sourceRate == targetRate) return true;
     
-    int numChannels = reader->numChannels;
-    if (numChannels == 1) return IRFormat::Mono;
-    if (numChannels == 2) return IRFormat::Stereo;
-    if (numChannels >= 4) return IRFormat::TrueStereo;
+    constexpr int chunkSize = 1 << 16;
+    constexpr int zeroCrossings = 16;       // each side of the kernel
+    constexpr int tableResolution = 512;    // kernel points per zero crossing
+    const double ratio = sourceRate / targetRate;               // input samples per output sample
+    const double cutoff = 0.5 * 0.95 * juce::jmin(1.0, 1.0 / ratio);  // cycles per input sample
+    const double halfWidth = zeroCrossings / (2.0 * cutoff);    // in input samples
     
-    return IRFormat::Stereo;  // Default
+    // sinc(u) * window(u / zeroCrossings) for u = 0 .. zeroCrossings, interpolated linearly
+    std::vector<float> kernel(static_cast<size_t>(zeroCrossings * tableResolution + 2), 0.0f);
+    for (size_t i = 0; i < kernel.size(); ++i) {
+        const double u = static_cast<double>(i) / tableResolution;
+        if (u >= zeroCrossings) break;
+        const double x = juce::MathConstants<double>::pi * u;
+        const double w = juce::MathConstants<double>::pi * u / zeroCrossings;
+        kernel[i] = static_cast<float>((i == 0 ? 1.0 : std::sin(x) / x) * (0.42 + 0.5 * std::cos(w) + 0.08 * std::cos(2.0 * w)));
+    }
+    const double tableStep = 2.0 * cutoff * tableResolution;   // table points per input sample
+    const float gain = static_cast<float>(2.0 * cutoff);
+    
+    const int numIn = ir.getNumSamples();
+    const int numOut = static_cast<int>(std::ceil(numIn / ratio));
+    juce::AudioBuffer<float> resampled(ir.getNumChannels(), numOut);
+    
+    for (int ch = 0; ch < ir.getNumChannels(); ++ch) {
+        const float* in = ir.getReadPointer(ch);
+        float* out = resampled.getWritePointer(ch);
+        for (int outPos = 0; outPos < numOut; outPos += chunkSize) {
+            if (juce::Thread::currentThreadShouldExit())
+                return false;
+            const int end = juce::jmin(numOut, outPos + chunkSize);
+            for (int k = outPos; k < end; ++k) {
+                const double centre = k * ratio;
+                const int first = juce::jmax(0, static_cast<int>(std::ceil(centre - halfWidth)));
+                const int last = juce::jmin(numIn - 1, static_cast<int>(std::floor(centre + halfWidth)));
+                float sum = 0.0f;
+                for (int i = first; i <= last; ++i) {
+                    const double position = std::abs(centre - i) * tableStep;
+                    const auto index = static_cast<size_t>(position);
+                    const float frac = static_cast<float>(position - static_cast<double>(index));
+                    sum += in[i] * (kernel[index] + frac * (kernel[index + 1] - kernel[index]));
+                }
+                out[k] = gain * sum;
+            }
+        }
+    }
+    ir = std::move(resampled);
+    return true;
 }
 
-void IRConvolutionEngine::loadTrueStereoIR(juce::AudioFormatReader* reader)
+static void trimAndNormaliseIR(juce::AudioBuffer<float>& ir)
 {
-    if (reader == nullptr) return;
+    // Same treatment juce::dsp::Convolution applies with Trim::yes / Normalise::yes
+    const float threshold = juce::Decibels::decibelsToGain(-80.0f);
+    const int numSamples = ir.getNumSamples();
+    int start = numSamples, end = 0;
+    
+    for (int ch = 0; ch < ir.getNumChannels(); ++ch) {
+        const float* data = ir.getReadPointer(ch);
+        for (int i = 0; i < numSamples; ++i) {
+            if (std::abs(data[i]) > threshold) {
+                start = juce::jmin(start, i);
+                end = juce::jmax(end, i + 1);
+            }
+        }
+    }
     
-    // Read all 4 channels
-    int numSamples = static_cast<int>(reader->lengthInSamples);
-    juce::AudioBuffer<float> buffer(4, numSamples);
-    reader->read(&buffer, 0, numSamples, 0, true, true);
+    if (start >= end) return;
     
-    // Extract individual channels
-    juce::AudioBuffer<float> ll(1, numSamples);
-    juce::AudioBuffer<float> lr(1, numSamples);
-    juce::AudioBuffer<float> rl(1, numSamples);
-    juce::AudioBuffer<float> rr(1, numSamples);
+    juce::AudioBuffer<float> trimmed(ir.getNumChannels(), end - start);
+    for (int ch = 0; ch < ir.getNumChannels(); ++ch)
+        trimmed.copyFrom(ch, 0, ir, ch, start, end - start);
+    
+    float maxEnergy = 0.0f;
+    for (int ch = 0; ch < trimmed.getNumChannels(); ++ch) {
+        const float* data = trimmed.getReadPointer(ch);
+        float energy = 0.0f;
+        for (int i = 0; i < trimmed.getNumSamples(); ++i)
+            energy += data[i] * data[i];
+        maxEnergy = juce::jmax(maxEnergy, energy);
+    }
+    // 0.125 (-18 dB) headroom, as JUCE's normalisation: a unit-energy IR at 100% wet
+    // would clip a bus
+    if (maxEnergy > 0.0f)
+        trimmed.applyGain(0.125f / std::sqrt(maxEnergy));
+    
+    ir = std::move(trimmed);
+}
+
+bool IRConvolutionEngine::readSourceIR(const BuildSettings& settings, juce::AudioBuffer<float>& dest)
+{
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
     
-    ll.copyFrom(0, 0, buffer, 0, 0, numSamples);
-    lr.copyFrom(0, 0, buffer, 1, 0, numSamples);
-    rl.copyFrom(0, 0, buffer, 2, 0, numSamples);
-    rr.copyFrom(0, 0, buffer, 3, 0, numSamples);
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(settings.file));
+    if (reader == nullptr) return false;
     
-    // Load into convolvers
-    convLL.loadImpulseResponse(ll, spec.sampleRate, juce::dsp::Convolution::Stereo::no, juce::dsp::Convolution::Trim::yes, 0);
-    convLR.loadImpulseResponse(lr, spec.sampleRate, juce::dsp::Convolution::Stereo::no, juce::dsp::Convolution::Trim::yes, 0);
-    convRL.loadImpulseResponse(rl, spec.sampleRate, juce::dsp::Convolution::Stereo::no, juce::dsp::Convolution::Trim::yes, 0);
-    convRR.loadImpulseResponse(rr, spec.sampleRate, juce::dsp::Convolution::Stereo::no, juce::dsp::Convolution::Trim::yes, 0);
+    // Keep the original channels; partitions are built from it
+    const int numChannels = static_cast<int>(reader->numChannels);
+    const int numSamples = static_cast<int>(reader->lengthInSamples);
+    dest.setSize(numChannels, numSamples);
+    return reader->read(&dest, 0, numSamples, 0, true, true);
+}
+
+// Cuts a measured IR where its decay meets the noise floor (Lundeby-style).
+// The floor is the mean energy of the last 10% (which must be flat); the decay slope comes from a fit to
+// the noise-compensated Schroeder integral between -5 dB and -25 dB (or 10 dB above
+// the floor when the range is smaller); the cut is where that line, anchored on the
+// 10 ms energy envelope, reaches the floor. The last fadeSamples before the cut get a
+// raised-cosine fade. Returns the number of samples removed (0 if no floor is found).
+static int truncateAtNoiseFloor(juce::AudioBuffer<float>& ir, double sampleRate, int fadeSamples)
+{
+    const int numSamples = ir.getNumSamples();
+    const int window = juce::jmax(1, static_cast<int>(sampleRate * 0.01));
+    const int numWindows = numSamples / window;
+    if (numWindows < 20) return 0;
+    
+    // Energy envelope, summed over channels
+    std::vector<double> energy(static_cast<size_t>(numWindows), 0.0);
+    for (int ch = 0; ch < ir.getNumChannels(); ++ch) {
+        const float* data = ir.getReadPointer(ch);
+        for (int w = 0; w < numWindows; ++w)
+            for (int i = w * window; i < (w + 1) * window; ++i)
+                energy[static_cast<size_t>(w)] += static_cast<double>(data[i]) * data[i];
+    }
+    
+    // A floor is flat: if the tail still falls by 3 dB across it, it is decay, not noise
+    const int noiseStart = numWindows - juce::jmax(2, numWindows / 10);
+    const int noiseMid = (noiseStart + numWindows) / 2;
+    double noiseEarly = 0.0, noiseLate = 0.0;
+    for (int w = noiseStart; w < numWindows; ++w)
+        (w < noiseMid ? noiseEarly : noiseLate) += energy[static_cast<size_t>(w)];
+    noiseEarly /= noiseMid - noiseStart;
+    noiseLate /= numWindows - noiseMid;
+    if (noiseEarly > 2.0 * noiseLate) return 0;
+    const double noise = 0.5 * (noiseEarly + noiseLate);
+    
+    const auto peak = std::max_element(energy.begin(), energy.end());
+    const int peakWindow = static_cast<int>(std::distance(energy.begin(), peak));
+    const double rangeDb = 10.0 * std::log10(*peak / juce::jmax(noise, 1.0e-30));
+    if (noise <= 0.0 || rangeDb < 20.0 || peakWindow >= noiseStart) return 0;
+    
+    // Schroeder backward integration with the noise floor removed
+    std::vector<double> edc(static_cast<size_t>(numWindows), 0.0);
+    double sum = 0.0;
+    for (int w = numWindows - 1; w >= peakWindow; --w) {
+        sum += juce::jmax(0.0, energy[static_cast<size_t>(w)] - noise);
+        edc[static_cast<size_t>(w)] = sum;
+    }
+    if (sum <= 0.0) return 0;
+    
+    const double fitEnd = -juce::jmin(25.0, rangeDb - 10.0);
+    double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+    int n = 0;
+    for (int w = peakWindow; w < numWindows; ++w) {
+        const double db = 10.0 * std::log10(juce::jmax(edc[static_cast<size_t>(w)], 1.0e-30) / sum);
+        if (db > -5.0) continue;
+        if (db < fitEnd) break;
+        sx += w; sy += db; sxx += static_cast<double>(w) * w; sxy += w * db;
+        ++n;
+    }
+    const double slope = n >= 2 ? (n * sxy - sx * sy) / (n * sxx - sx * sx) : 0.0;
+    if (slope >= 0.0) return 0;
+    
+    // Anchor the decay line on the envelope over the fitted region
+    double offset = 0.0;
+    int numAnchors = 0;
+    for (int w = peakWindow; w < noiseStart; ++w) {
+        const double level = 10.0 * std::log10(juce::jmax(energy[static_cast<size_t>(w)], 1.0e-30));
+        const double edcDb = 10.0 * std::log10(juce::jmax(edc[static_cast<size_t>(w)], 1.0e-30) / sum);
+        if (edcDb > -5.0) continue;
+        if (edcDb < fitEnd) break;
+        offset += level - slope * w;
+        ++numAnchors;
+    }
+    if (numAnchors == 0) return 0;
+    offset /= numAnchors;
+    
+    const double crossing = (10.0 * std::log10(noise) - offset) / slope;
+    const int cut = juce::jlimit(0, numSamples, static_cast<int>(std::ceil(crossing + 1.0)) * window);
+    if (cut >= numSamples) return 0;
+    
+    const int fade = juce::jmin(fadeSamples, cut);
+    for (int ch = 0; ch < ir.getNumChannels(); ++ch) {
+        float* data = ir.getWritePointer(ch);
+        for (int i = 0; i < fade; ++i) {
+            const double t = static_cast<double>(i + 1) / fade;
+            data[cut - fade + i] *= static_cast<float>(0.5 * (1.0 + std::cos(juce::MathConstants<double>::pi * t)));
+        }
+    }
+    ir.setSize(ir.getNumChannels(), cut, true);
+    return numSamples - cut;
+}
+
+IRConvolutionEngine::BuildSettings IRConvolutionEngine::getBuildSettings() const
+{
+    BuildSettings settings;
+    settings.spec = spec;
+    settings.format = format;
+    settings.file = irFile;
+    settings.hash = irHash;
+    settings.sourceSampleRate = irSampleRate;
+    settings.sourceLength = irSourceLength;
+    settings.sourceInfo = sourceInfo;
+    settings.lowLatency = lowLatency;
+    settings.backgroundTail = backgroundTail;
+    settings.hybridTail = hybridTail;
+    settings.timeScale = builtTimeScale;
+    return settings;
+}
+
+std::unique_ptr<PartitionedConvolver> IRConvolutionEngine::createConvolver(const BuildSettings& settings)
+{
+    const int maxBlock = static_cast<int>(settings.spec.maximumBlockSize);
+    const auto key = IRSpectraCache::makeKey(settings.hash, settings.spec.sampleRate, maxBlock, settings.lowLatency,
+                                             settings.backgroundTail, settings.hybridTail, settings.timeScale);
+    
+    // Spectra are shared read-only with every other instance using this IR; a stale
+    // or corrupt cache entry is dropped and rebuilt once
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        auto spectra = SharedIRStore::acquire(key, [&settings] { return buildConvolver(settings); });
+        if (spectra == nullptr) return nullptr;
+        
+        auto newConvolver = std::make_unique<PartitionedConvolver>();
+        newConvolver->prepare(maxBlock, settings.lowLatency, settings.backgroundTail);
+        const void* data = spectra->getData();
+        const size_t size = spectra->getSize();
+        if (newConvolver->readSpectra(data, size, std::move(spectra)))
+            return newConvolver;
+        SharedIRStore::discard(key);
+    }
+    return nullptr;
+}
+
+std::unique_ptr<PartitionedConvolver> IRConvolutionEngine::buildConvolver(const BuildSettings& settings)
+{
+    const auto& spec = settings.spec;
+    const int maxBlock = static_cast<int>(spec.maximumBlockSize);
+    // Every step may take seconds on long IRs; a loader asked to exit abandons the build
+    // instead of holding up the thread's shutdown
+    juce::AudioBuffer<float> ir;
+    if (!readSourceIR(settings, ir) || juce::Thread::currentThreadShouldExit())
+        return nullptr;
+    if (settings.format == IRFormat::FOA)
+        decodeFOAToStereo(ir);
+    
+    // Stretching by s plays the IR as if recorded at its sample rate / s: decay times
+    // scale by s (and the spectrum by 1/s)
+    if (!resampleIR(ir, settings.sourceSampleRate / settings.timeScale, spec.sampleRate))
+        return nullptr;
+    truncateAtNoiseFloor(ir, spec.sampleRate, static_cast<int>(spec.sampleRate * truncationFadeSeconds));
+    trimAndNormaliseIR(ir);
+    
+    const int numInputs = 2, numOutputs = 2;
+    std::vector<PartitionedConvolver::Path> paths;
+    switch (settings.format) {
+        case IRFormat::Mono:
+            // Same IR on both channels, transformed once
+            paths = PartitionedConvolver::diagonalPaths(2, true);
+            break;
+        case IRFormat::Stereo:
+        case IRFormat::FOA:     // Decoded to stereo above
+            paths = PartitionedConvolver::diagonalPaths(2, false);
+            break;
+        case IRFormat::TrueStereo:
+            // LL, LR, RL, RR: L out = LL*L + LR*R, R out = RL*L + RR*R
+            paths = PartitionedConvolver::matrixPaths(2, 2);
+            break;
+    }
+    
+    auto newConvolver = std::make_unique<PartitionedConvolver>();
+    newConvolver->prepare(maxBlock, settings.lowLatency, settings.backgroundTail);
+    
+    // Hybrid: the tail after the cutoff is analysed, then the early part fades out
+    // under the network's build-up. Short IRs are convolved whole.
+    const int cutoff = static_cast<int>(spec.sampleRate * hybridCutoffSeconds);
+    const int fade = static_cast<int>(spec.sampleRate * hybridFadeSeconds);
+    const bool useTail = settings.hybridTail && ir.getNumSamples() > 2 * cutoff;
+    FDNTail::Settings tailSettings;
+    if (useTail) {
+        std::vector<std::vector<int>> outputChannels(static_cast<size_t>(numOutputs));
+        for (const auto& p : paths)
+            outputChannels[static_cast<size_t>(p.output)].push_back(p.irChannel);
+        tailSettings = FDNTail::analyse(ir, outputChannels, cutoff, fade, spec.sampleRate);
+        if (juce::Thread::currentThreadShouldExit())
+            return nullptr;
+        
+        ir.setSize(ir.getNumChannels(), cutoff, true);
+        for (int i = 0; i < fade; ++i) {
+            const float gain = 0.5f * (1.0f + std::cos(juce::MathConstants<float>::pi * (i + 1) / fade));
+            for (int ch = 0; ch < ir.getNumChannels(); ++ch)
+                ir.setSample(ch, cutoff - fade + i, ir.getSample(ch, cutoff - fade + i) * gain);
+        }
+    }
+    
+    newConvolver->setImpulseResponse(ir, numInputs, numOutputs, paths);
+    if (juce::Thread::currentThreadShouldExit())
+        return nullptr;  // The partitions may be incomplete
+    if (useTail)
+        newConvolver->setTail(tailSettings);
+    return newConvolver;
 }
 
 bool IRConvolutionEngine::loadIR(const juce::File& file)
 {
     if (!file.existsAsFile()) {
+        const juce::ScopedLock rl(requestLock);
         irInfo = "File not found";
         return false;
     }
     
+    // Decoding (or restoring) happens on the loader thread; the current IR keeps
+    // playing until the new one is crossfaded in
+    {
+        const juce::ScopedLock rl(requestLock);
+        requestedFile = file;
+        loadRequested = true;
+        irInfo = "Loading " + file.getFileName() + "...";
+    }
+    notify();
+    return true;
+}
+
+bool IRConvolutionEngine::loadIRNow(const juce::File& file)
+{
+    if (!file.existsAsFile()) {
+        const juce::ScopedLock rl(requestLock);
+        irInfo = "File not found";
+        return false;
+    }
+    
+    // prepare() builds the opened source for the current spec and stretch
+    const juce::ScopedLock sourceLock(irSourceLock);
+    jassert(spec.sampleRate > 0.0);
+    if (spec.sampleRate <= 0.0 || !openSourceIR(file))
+        return false;
+    {
+        // Supersedes anything still queued for the loader thread
+        const juce::ScopedLock rl(requestLock);
+        loadRequested = false;
+    }
+    prepare(spec);
+    return convolver != nullptr;
+}
+
+bool IRConvolutionEngine::openSourceIR(const juce::File& file)
+{
     juce::AudioFormatManager formatManager;
     formatManager.registerBasicFormats();
     
     std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
     if (reader == nullptr) {
+        const juce::ScopedLock rl(requestLock);
         irInfo = "Unsupported format";
         return false;
     }
     
-    format = detectIRFormat(reader.get());
+    // The bus is stereo: a wider IR (e.g. a 16-channel FOA matrix) has no outputs to play on
+    if (reader->numChannels != 1 && reader->numChannels != 2 && reader->numChannels != 4) {
+        const juce::ScopedLock rl(requestLock);
+        irInfo = juce::String(reader->numChannels) + "-channel IRs are not supported "
+                 "(mono, stereo, true-stereo or 4-channel FOA)";
+        return false;
+    }
+    
+    // Only the header is read here; samples are decoded if the spectra are not cached
+    format = detectIRFormat(*reader, file);
     irSampleRate = reader->sampleRate;
+    irFile = file;
+    irHash = IRSpectraCache::hashFile(file);
+    irSourceLength = static_cast<int>(reader->lengthInSamples);
     
-    if (format == IRFormat::TrueStereo) {
-        // Load 4-channel true-stereo IR
-        loadTrueStereoIR(reader.get());
-        trueStereoMode = true;
-        
-        irInfo = juce::String(reader->numChannels) + "ch True-Stereo, " +
+    const char* formatNames[] = { "Mono", "Stereo", "True-Stereo", "FOA (stereo decode)" };
+    sourceInfo = juce::String(reader->numChannels) + "ch " + formatNames[static_cast<int>(format)] + ", " +
                  juce::String(static_cast<int>(reader->sampleRate)) + "Hz, " +
                  juce::String(reader->lengthInSamples / reader->sampleRate, 2) + "s";
-    } else {
-        // Load mono or stereo IR
-        if (format == IRFormat::Mono) {
-            conv.loadImpulseResponse(file, spec.sampleRate, juce::dsp::Convolution::Stereo::no, juce::dsp::Convolution::Trim::yes, 0);
-            irInfo = "Mono, " + juce::String(static_cast<int>(reader->sampleRate)) + "Hz, " +
-                     juce::String(reader->lengthInSamples / reader->sampleRate, 2) + "s";
-        } else {
-            conv.loadImpulseResponse(file, spec.sampleRate, juce::dsp::Convolution::Stereo::yes, juce::dsp::Convolution::Trim::yes, 0);
-            irInfo = "Stereo, " + juce::String(static_cast<int>(reader->sampleRate)) + "Hz, " +
-                     juce::String(reader->lengthInSamples / reader->sampleRate, 2) + "s";
-        }
-        trueStereoMode = false;
+    return true;
+}
+
+void IRConvolutionEngine::setLowLatency(bool enabled)
+{
+    {
+        const juce::ScopedLock rl(requestLock);
+        requestedLowLatency = enabled;
     }
+    notify();
+}
+
+void IRConvolutionEngine::setBackgroundTail(bool enabled)
+{
+    {
+        const juce::ScopedLock rl(requestLock);
+        requestedBackgroundTail = enabled;
+    }
+    notify();
+}
+
+void IRConvolutionEngine::setHybridTail(bool enabled)
+{
+    {
+        const juce::ScopedLock rl(requestLock);
+        requestedHybridTail = enabled;
+    }
+    notify();
+}
+
+juce::String IRConvolutionEngine::describeTrim(const BuildSettings& settings, const PartitionedConvolver& built)
+{
+    const double sampleRate = settings.spec.sampleRate;
+    if (built.hasTail())
+        return settings.sourceInfo + ", FDN tail from " + juce::String(built.getIRLength() / sampleRate, 2) + "s";
     
-    // Store original IR for time scaling (if needed)
-    // Note: Time scaling via resampling is complex, so we'll use a simpler approach
-    // For now, timeScale parameter affects the IR length by truncation/extension
-    
-    return true;
+    // Length the stretched, resampled source would have without any trimming
+    const auto fullLength = static_cast<int>(std::ceil(settings.sourceLength * settings.timeScale * sampleRate
+                                                       / settings.sourceSampleRate));
+    const int removed = juce::jmax(0, fullLength - built.getIRLength());
+    if (removed == 0) return settings.sourceInfo;
+    return settings.sourceInfo + ", trimmed " + juce::String(removed) + " samples ("
+         + juce::String(removed / sampleRate, 2) + "s)";
+}
+
+juce::String IRConvolutionEngine::getIRInfo() const
+{
+    const juce::ScopedLock rl(requestLock);
+    return irInfo;
 }
 
 void IRConvolutionEngine::updateTimeScale()
 {
-    // Time scaling for convolution is complex - would require resampling the IR
-    // For now, we'll note that the parameter is available but full implementation
-    // would require storing and resampling the IR buffer
-    // This is a placeholder for future enhancement
-    currentTimeScale = params.timeScale;
+    // Audio thread: just publish the request, the loader thread does the work
+    requestedTimeScale.store(params.timeScale, std::memory_order_relaxed);
 }
 
-void IRConvolutionEngine::process(juce::AudioBuffer<float>& buffer)
+void IRConvolutionEngine::run()
 {
-    if (trueStereoMode && buffer.getNumChannels() >= 2) {
-        // True-stereo: 4 convolvers (LL, LR, RL, RR)
-        // Left output = LL*L + LR*R
-        // Right output = RL*L + RR*R
-        const int numSamples = buffer.getNumSamples();
-        
-        // Extract left and right input
-        juce::AudioBuffer<float> leftInput(1, numSamples);
-        juce::AudioBuffer<float> rightInput(1, numSamples);
-        leftInput.copyFrom(0, 0, buffer, 0, 0, numSamples);
-        rightInput.copyFrom(0, 0, buffer, 1, 0, numSamples);
-        
-        // Process: LL*L
-        juce::AudioBuffer<float> llOut(1, numSamples);
-        llOut.copyFrom(0, 0, leftInput, 0, 0, numSamples);
-        juce::dsp::AudioBlock<float> llBlock(llOut);
-        juce::dsp::ProcessContextReplacing<float> llCtx(llBlock);
-        convLL.process(llCtx);
+    float lastRequest = requestedTimeScale.load();
+    auto lastChange = juce::Time::getMillisecondCounter();
+    
+    while (!threadShouldExit()) {
+        delete retiredConvolver.exchange(nullptr, std::memory_order_acquire);
         
-        // Process: LR*R
-        juce::AudioBuffer<float> lrOut(1, numSamples);
-        lrOut.copyFrom(0, 0, rightInput, 0, 0, numSamples);
-        juce::dsp::AudioBlock<float> lrBlock(lrOut);
-        juce::dsp::ProcessContextReplacing<float> lrCtx(lrBlock);
-        convLR.process(lrCtx);
+        // Debounce: only restretch once the knob has rested for debounceMs
+        const float request = requestedTimeScale.load(std::memory_order_relaxed);
+        const auto now = juce::Time::getMillisecondCounter();
+        if (request != lastRequest) {
+            lastRequest = request;
+            lastChange = now;
+        }
+        const bool scaleSettled = now - lastChange >= static_cast<juce::uint32>(debounceMs);
         
-        // Process: RL*L
-        juce::AudioBuffer<float> rlOut(1, numSamples);
-        rlOut.copyFrom(0, 0, leftInput, 0, 0, numSamples);
-        juce::dsp::AudioBlock<float> rlBlock(rlOut);
-        juce::dsp::ProcessContextReplacing<float> rlCtx(rlBlock);
-        convRL.process(rlCtx);
+        BuildSettings settings;
+        bool build = false, load = false;
+        int generation = 0;
+        {
+            // Requests are taken under irSourceLock, so loadIRNow() can withdraw a queued one
+            const juce::ScopedLock sourceLock(irSourceLock);
+            juce::File fileToLoad;
+            bool wantLowLatency = false, wantBackgroundTail = false, wantHybridTail = false;
+            {
+                const juce::ScopedLock rl(requestLock);
+                std::swap(load, loadRequested);
+                fileToLoad = requestedFile;
+                wantLowLatency = requestedLowLatency;
+                wantBackgroundTail = requestedBackgroundTail;
+                wantHybridTail = requestedHybridTail;
+            }
+            
+            bool rebuild = load && openSourceIR(fileToLoad);
+            if (wantLowLatency != lowLatency || wantBackgroundTail != backgroundTail || wantHybridTail != hybridTail) {
+                lowLatency = wantLowLatency;
+                backgroundTail = wantBackgroundTail;
+                hybridTail = wantHybridTail;
+                rebuild = true;
+            }
+            if (scaleSettled && request != builtTimeScale)
+                rebuild = true;
+            
+            // Nothing is built before the first prepare(); it builds what was opened
+            if (rebuild && irHash.isNotEmpty() && spec.sampleRate > 0.0) {
+                builtTimeScale = request;
+                settings = getBuildSettings();
+                generation = buildGeneration;
+                build = true;
+            }
+        }
         
-        // Process: RR*R
-        juce::AudioBuffer<float> rrOut(1, numSamples);
-        rrOut.copyFrom(0, 0, rightInput, 0, 0, numSamples);
-        juce::dsp::AudioBlock<float> rrBlock(rrOut);
-        juce::dsp::ProcessContextReplacing<float> rrCtx(rrBlock);
-        convRR.process(rrCtx);
+        // Outside the lock: prepare() on the message thread must not wait for this
+        if (build) {
+            auto built = createConvolver(settings);
+            const juce::ScopedLock sourceLock(irSourceLock);
+            if (generation != buildGeneration) {
+                // prepare() ran meanwhile and built the current source for its own spec
+            } else if (built != nullptr) {
+                const auto info = describeTrim(settings, *built);
+                // Replaces a build the audio thread has not picked up yet
+                delete pendingConvolver.exchange(built.release(), std::memory_order_acq_rel);
+                const juce::ScopedLock rl(requestLock);
+                irInfo = info;
+            } else if (load) {
+                const juce::ScopedLock rl(requestLock);
+                irInfo = "Failed to load " + settings.file.getFileName();
+            }
+        }
         
-        // Mix outputs: Left = LL + LR, Right = RL + RR
-        buffer.copyFrom(0, 0, llOut, 0, 0, numSamples);
-        buffer.addFrom(0, 0, lrOut, 0, 0, numSamples);
-        buffer.copyFrom(1, 0, rlOut, 0, 0, numSamples);
-        buffer.addFrom(1, 0, rrOut, 0, 0, numSamples);
+        wait(20);
+    }
+}
+
+void IRConvolutionEngine::acceptPendingConvolver()
+{
+    // One crossfade at a time, and the previous fade's convolver must have been freed
+    if (fadingConvolver != nullptr || retiredConvolver.load(std::memory_order_relaxed) != nullptr)
+        return;
+    
+    auto* next = pendingConvolver.exchange(nullptr, std::memory_order_acq_rel);
+    if (next == nullptr)
+        return;
+    
+    // The first IR simply starts; its reverb builds up from silence
+    if (convolver != nullptr) {
+        fadingConvolver = std::move(convolver);
+        fadeRemaining = fadeLength;
+    }
+    convolver.reset(next);
+    activeLatency.store(convolver->getLatencySamples(), std::memory_order_relaxed);
+    activeMemory.store(juce::jmax(convolver->getMemorySamples(),
+                                  fadingConvolver != nullptr ? fadingConvolver->getMemorySamples() : 0),
+                       std::memory_order_relaxed);
+    activeDecay.store(convolver->getDecaySamples(), std::memory_order_relaxed);
+}
+
+void IRConvolutionEngine::processCrossfade(juce::AudioBuffer<float>& buffer)
+{
+    // The outgoing convolver keeps running on a copy of the input and is faded
+    // out linearly (both IRs are correlated) while the new one fades in
+    const int numSamples = juce::jmin(buffer.getNumSamples(), fadeBuffer.getNumSamples());
+    const int numChannels = juce::jmin(buffer.getNumChannels(), fadeBuffer.getNumChannels());
+    for (int ch = 0; ch < numChannels; ++ch)
+        fadeBuffer.copyFrom(ch, 0, buffer, ch, 0, numSamples);
+    
+    auto* fadeChannels = fadeBuffer.getArrayOfWritePointers();
+    fadingConvolver->process(fadeChannels, fadeChannels, numSamples);
+    auto* channels = buffer.getArrayOfWritePointers();
+    convolver->process(channels, channels, buffer.getNumSamples());
+    
+    // Channels the outgoing IR did not produce fade from silence
+    const int fadeSamples = juce::jmin(numSamples, fadeRemaining);
+    const int fadingOutputs = juce::jmin(numChannels, fadingConvolver->getNumOutputs());
+    for (int ch = 0; ch < numChannels; ++ch) {
+        float* out = channels[ch];
+        const float* old = fadeChannels[ch];
+        for (int i = 0; i < fadeSamples; ++i) {
+            const float gain = 1.0f - static_cast<float>(fadeRemaining - i) / static_cast<float>(fadeLength);
+            out[i] = gain * out[i] + (ch < fadingOutputs ? (1.0f - gain) * old[i] : 0.0f);
+        }
+    }
+    
+    fadeRemaining -= fadeSamples;
+    if (fadeRemaining == 0)
+        retiredConvolver.store(fadingConvolver.release(), std::memory_order_release);
+}
+
+void IRConvolutionEngine::process(juce::AudioBuffer<float>& buffer)
+{
+    // One forward FFT per input and partition, one inverse FFT per output (e.g. true-stereo:
+    // L out = LL*L + LR*R, R out = RL*L + RR*R). Runs in place on the host buffer;
+    // new IRs arrive through the lock-free handoff.
+    acceptPendingConvolver();
+    if (convolver != nullptr
+        && buffer.getNumChannels() >= juce::jmax(convolver->getNumInputs(), convolver->getNumOutputs())) {
+        if (fadingConvolver != nullptr) {
+            processCrossfade(buffer);
+        } else {
+            auto* channels = buffer.getArrayOfWritePointers();
+            convolver->process(channels, channels, buffer.getNumSamples());
+        }
+        numTailFallbacks.store(convolver->getNumTailFallbacks(), std::memory_order_relaxed);
     } else {
-        // Standard stereo or mono
-        juce::dsp::AudioBlock<float> block(buffer);
-        juce::dsp::ProcessContextReplacing<float> ctx(block);
-        conv.process(ctx);
+        buffer.clear();
     }
     
     // Apply width parameter (M/S processing)
@@ -191,11 +691,3 @@ void IRConvolutionEngine::process(juce::AudioBuffer<float>& buffer)
         }
     }
 }
-
-int IRConvolutionEngine::getLatencySamples() const
-{
-    if (trueStereoMode) {
-        return convLL.getLatency();
-    }
-    return conv.getLatency();
-}
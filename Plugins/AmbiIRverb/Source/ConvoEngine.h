@@ -1,45 +1,132 @@
 #pragma once
 #include "HybridVerb.h"
+#include "PartitionedConvolver.h"
+#include "SharedIRStore.h"
 #include <JuceHeader.h>
 
-enum class IRFormat { Mono, Stereo, TrueStereo };
+// TrueStereo is 4 channels LL/LR/RL/RR. FOA is a 4-channel first-order B-format
+// response in AmbiX order (W, Y, Z, X), as IRKit's exportFOAIR writes it; the bus is
+// stereo, so it is decoded to a stereo IR. Both have 4 channels, so FOA is told apart
+// by its name (IRKit's "IR_FOA_...", "AmbiX" or a .amb file).
+enum class IRFormat { Mono, Stereo, TrueStereo, FOA };
 
-class IRConvolutionEngine : public IReverbEngine
+class IRConvolutionEngine : public IReverbEngine,
+                            private juce::Thread
 {
 public:
     IRConvolutionEngine();
+    ~IRConvolutionEngine() override;
     void prepare(const juce::dsp::ProcessSpec& spec) override;
     void reset() override;
     void setParams(const EngineParams& p) override { params = p; updateTimeScale(); }
     void process(juce::AudioBuffer<float>& buffer) override;
 
+    // Queues the file for the loader thread and returns straight away; false if it
+    // does not exist. The current IR plays until the new one is crossfaded in.
+    // Before the first prepare() the file is only opened; prepare() builds it.
     bool loadIR(const juce::File& file);
-    int getLatencySamples() const;
-    IRFormat getFormat() const { return format; }
-    juce::String getIRInfo() const { return irInfo; }
+    // Opens and builds the IR on the calling thread and plays it at once, without a
+    // crossfade. Only while the audio thread is stopped (offline rendering), after prepare().
+    bool loadIRNow(const juce::File& file);
+    // Low latency = direct-form head + growing partitions (zero latency);
+    // otherwise uniform partitions at the host block size (one block of latency).
+    // Applied by the loader thread.
+    void setLowLatency(bool enabled);
+    // In low-latency mode, compute the longest partitions on a worker thread.
+    void setBackgroundTail(bool enabled);
+    // Convolve only the first hybridCutoffSeconds of long IRs and continue with an
+    // FDN matched to the rest (per-band RT60 and energy). Much cheaper for long halls.
+    void setHybridTail(bool enabled);
+    int getNumTailFallbacks() const { return numTailFallbacks.load(); }
+    // Latency of the convolver currently playing
+    int getLatencySamples() const { return activeLatency.load(); }
+    double getMemorySeconds() const override { return spec.sampleRate > 0.0 ? activeMemory.load() / spec.sampleRate : 0.0; }
+    double getDecaySeconds() const override { return spec.sampleRate > 0.0 ? activeDecay.load() / spec.sampleRate : 0.0; }
+    juce::String getIRInfo() const;
 
 private:
-    IRFormat detectIRFormat(juce::AudioFormatReader* reader);
+    // Everything a build reads: copied under irSourceLock, so the build itself (seconds
+    // on long IRs) runs without it and prepare() never waits for one
+    struct BuildSettings
+    {
+        juce::dsp::ProcessSpec spec {};
+        IRFormat format = IRFormat::Stereo;
+        juce::File file;
+        juce::String hash;
+        double sourceSampleRate = 48000.0;
+        int sourceLength = 0;
+        juce::String sourceInfo;
+        bool lowLatency = false;
+        bool backgroundTail = false;
+        bool hybridTail = false;
+        float timeScale = 1.0f;
+    };
+    
+    static IRFormat detectIRFormat(const juce::AudioFormatReader& reader, const juce::File& file);
     void updateTimeScale();
-    void loadTrueStereoIR(juce::AudioFormatReader* reader);
+    // Call with irSourceLock held
+    BuildSettings getBuildSettings() const;
+    // Restores from the shared store / disk cache, building only on a miss
+    static std::unique_ptr<PartitionedConvolver> createConvolver(const BuildSettings& settings);
+    static std::unique_ptr<PartitionedConvolver> buildConvolver(const BuildSettings& settings);
+    static bool readSourceIR(const BuildSettings& settings, juce::AudioBuffer<float>& dest);
+    bool openSourceIR(const juce::File& file);
+    // Source info plus how many samples noise-floor truncation and trimming removed,
+    // or where the FDN tail takes over
+    static juce::String describeTrim(const BuildSettings& settings, const PartitionedConvolver& built);
     
-    EngineParams params;
-    juce::dsp::ProcessSpec spec;
+    // Loader thread: opens requested IRs, applies layout changes, debounces rtScale,
+    // and hands finished convolvers to the audio thread; also frees retired ones
+    void run() override;
+    void acceptPendingConvolver();
+    void processCrossfade(juce::AudioBuffer<float>& buffer);
     
-    // Standard stereo convolution
-    juce::dsp::Convolution conv;
+    EngineParams params;
+    juce::dsp::ProcessSpec spec {};     // sampleRate 0 until the first prepare()
     
-    // True-stereo convolution (4 channels: LL, LR, RL, RR)
-    juce::dsp::Convolution convLL, convLR, convRL, convRR;
+    // Requests from the message thread; requestLock is only held for copies
+    juce::CriticalSection requestLock;
+    juce::File requestedFile;
+    bool loadRequested = false;
+    bool requestedLowLatency = false;
+    bool requestedBackgroundTail = false;
+    bool requestedHybridTail = false;
+    juce::String irInfo;
     
+    // Source IR and build settings, owned by the loader thread (and prepare())
+    juce::CriticalSection irSourceLock;
     IRFormat format = IRFormat::Stereo;
-    bool trueStereoMode = false;
-    
-    // Time scaling
-    float currentTimeScale = 1.0f;
-    juce::AudioBuffer<float> irBuffer;  // Original IR for time scaling
+    juce::File irFile;
+    juce::String irHash;                // SHA-256 of irFile, keys the shared spectra
     double irSampleRate = 48000.0;
+    int irSourceLength = 0;
+    juce::String sourceInfo;
+    bool lowLatency = false;
+    bool backgroundTail = false;
+    bool hybridTail = false;
+    float builtTimeScale = 1.0f;        // Stretch of the IR currently built
+    int buildGeneration = 0;            // Bumped by prepare(); a loader build started before is dropped
     
-    // Info
-    juce::String irInfo;
+    // The audio thread only publishes the requested stretch; finished convolvers
+    // travel through single-slot handoffs in both directions, so it never locks
+    static constexpr double truncationFadeSeconds = 0.05;
+    static constexpr double hybridCutoffSeconds = 0.2;
+    static constexpr double hybridFadeSeconds = 0.03;
+    static constexpr int debounceMs = 150;
+    static constexpr double crossfadeSeconds = 0.03;
+    std::atomic<float> requestedTimeScale { 1.0f };
+    std::atomic<PartitionedConvolver*> pendingConvolver { nullptr };
+    std::atomic<PartitionedConvolver*> retiredConvolver { nullptr };
+    std::atomic<int> activeLatency { 0 };
+    std::atomic<int> activeMemory { 0 };   // Of the playing (and any fading) convolver
+    std::atomic<int> activeDecay { 0 };    // Of the playing convolver
+    std::atomic<int> numTailFallbacks { 0 };
+    
+    // Audio thread only: partitioned convolution for every IR format, one shared
+    // FFT per input, and the outgoing convolver while a crossfade runs
+    std::unique_ptr<PartitionedConvolver> convolver;
+    std::unique_ptr<PartitionedConvolver> fadingConvolver;
+    juce::AudioBuffer<float> fadeBuffer;
+    int fadeLength = 0;
+    int fadeRemaining = 0;
 };
@@ -0,0 +1,86 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-instance delay memory: a single allocation that the engines' delay lines
+// are packed into back to back, so they share cache lines and pages instead of
+// being scattered over the heap. HybridVerb asks an engine for its size at the
+// current spec, allocates once and hands the engine its Region.
+// No JUCE dependency.
+class DelayArena
+{
+public:
+    // Slices start on cache-line boundaries (also enough for AVX stores)
+    static constexpr size_t alignmentFloats = 64 / sizeof(float);
+
+    static size_t roundUp(size_t numFloats)
+    {
+        return (numFloats + alignmentFloats - 1) / alignmentFloats * alignmentFloats;
+    }
+
+    // Hands out consecutive slices of an arena. A default-constructed Region has
+    // no memory and only counts, which is how the engines report their size.
+    class Region
+    {
+    public:
+        Region() = default;
+        Region(float* start, size_t numFloats) : data(start), size(numFloats) {}
+
+        // numFloats floats, cache-line aligned; nullptr when only counting
+        float* take(size_t numFloats)
+        {
+            const size_t offset = used;
+            used += roundUp(numFloats);
+            if (data == nullptr)
+                return nullptr;
+            assert(used <= size);
+            return data + offset;
+        }
+
+        bool isCounting() const { return data == nullptr; }
+        // Floats taken so far, including alignment padding
+        size_t getUsed() const { return used; }
+
+    private:
+        float* data = nullptr;
+        size_t size = 0;
+        size_t used = 0;
+    };
+
+    // Replaces the arena with numFloats zeroed floats. Not real-time safe.
+    void allocate(size_t numFloats)
+    {
+        storage.assign(numFloats + alignmentFloats, 0.0f);
+        const auto address = reinterpret_cast<std::uintptr_t>(storage.data());
+        constexpr size_t alignmentBytes = alignmentFloats * sizeof(float);
+        aligned = storage.data() + ((alignmentBytes - address % alignmentBytes) % alignmentBytes) / sizeof(float);
+        numAligned = numFloats;
+    }
+
+    Region getRegion(size_t offset, size_t numFloats)
+    {
+        assert(offset + numFloats <= numAligned);
+        return Region(aligned + offset, numFloats);
+    }
+
+    // `assigned` if it has memory; otherwise (an engine used outside HybridVerb)
+    // this arena, allocated to numFloats
+    Region assignedOrOwn(Region assigned, size_t numFloats)
+    {
+        if (! assigned.isCounting())
+            return assigned;
+        allocate(numFloats);
+        return getRegion(0, numFloats);
+    }
+
+    size_t getNumFloats() const { return numAligned; }
+    // Size of the allocation, alignment slack included
+    size_t getBytes() const { return storage.size() * sizeof(float); }
+
+private:
+    std::vector<float> storage;
+    float* aligned = nullptr;
+    size_t numAligned = 0;
+};
@@ -1,24 +1,57 @@
 #pragma once
 #include <JuceHeader.h>
+#include <vector>
 
 class Diffuser {
 public:
-    void prepare(const juce::dsp::ProcessSpec& spec) { sampleRate = spec.sampleRate; juce::ignoreUnused(spec); }
-    void setAmount(float a) { amount = juce::jlimit(0.0f, 1.0f, a/100.0f); }
+    void prepare(const juce::dsp::ProcessSpec& spec) {
+        sampleRate = spec.sampleRate;
+        amount.reset(sampleRate, rampSeconds);
+        lastInput.assign(spec.numChannels, 0.0f);
+        lastOutput.assign(spec.numChannels, 0.0f);
+    }
+    void setAmount(float a) { amount.setTargetValue(juce::jlimit(0.0f, 1.0f, a/100.0f)); }
     void process(juce::AudioBuffer<float>& buf) {
-        if (amount <= 1e-6f) return;
         auto n = buf.getNumSamples();
-        for (int ch=0; ch<buf.getNumChannels(); ++ch) {
-            auto* x = buf.getWritePointer(ch);
-            float g = 0.35f * amount;
-            for (int i=1; i<n; ++i) {
-                auto y = x[i] + g * x[i-1];
-                x[i-1] = x[i-1] - g * y;
-                x[i] = y;
+        const int numChannels = juce::jmin(buf.getNumChannels(), static_cast<int>(lastInput.size()));
+        if (!amount.isSmoothing()) {
+            if (amount.getTargetValue() <= 1e-6f) {
+                // Bypassed: start from silence when it comes back
+                std::fill(lastInput.begin(), lastInput.end(), 0.0f);
+                std::fill(lastOutput.begin(), lastOutput.end(), 0.0f);
+                return;
             }
+            const float g = 0.35f * amount.getTargetValue();
+            for (int ch=0; ch<numChannels; ++ch)
+                diffuse(buf.getWritePointer(ch), n, static_cast<size_t>(ch), [g] { return g; });
+            return;
+        }
+        // The same gain sequence for every channel
+        const auto start = amount;
+        for (int ch=0; ch<numChannels; ++ch) {
+            amount = start;
+            diffuse(buf.getWritePointer(ch), n, static_cast<size_t>(ch), [this] { return 0.35f * amount.getNextValue(); });
         }
     }
 private:
+    // First-order allpass, y[n] = -g x[n] + x[n-1] + g y[n-1], one gain per sample.
+    // The previous input and output carry over, so the result does not depend on
+    // how the host (or the 32-sample sub-blocks) split the signal.
+    template <typename Gain>
+    void diffuse(float* x, int n, size_t ch, Gain nextGain) {
+        float x1 = lastInput[ch], y1 = lastOutput[ch];
+        for (int i=0; i<n; ++i) {
+            const float g = nextGain();
+            const float y = -g * x[i] + x1 + g * y1;
+            x1 = x[i];
+            y1 = y;
+            x[i] = y;
+        }
+        lastInput[ch] = x1;
+        lastOutput[ch] = y1;
+    }
+    static constexpr double rampSeconds = 0.05;
     double sampleRate = 48000.0;
-    float amount = 0.0f;
+    juce::SmoothedValue<float> amount { 0.0f };
+    std::vector<float> lastInput, lastOutput;  // Per channel
 };
@@ -0,0 +1,608 @@
+#include "FDNCore.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+ #define AMBIGLASS_FDN_X86 1
+ #include <immintrin.h>
+ #if defined(_MSC_VER) && !defined(__clang__)
+  #include <intrin.h>
+  #define AMBIGLASS_TARGET_SSE2
+  #define AMBIGLASS_TARGET_AVX2
+ #else
+  // Only these functions are compiled for the extension; the rest of the plugin
+  // keeps the baseline instruction set
+  #define AMBIGLASS_TARGET_SSE2 __attribute__((target("sse2")))
+  #define AMBIGLASS_TARGET_AVX2 __attribute__((target("avx2")))
+ #endif
+#else
+ #define AMBIGLASS_FDN_X86 0
+#endif
+
+//==============================================================================
+FDNCore::Isa FDNCore::detectIsa()
+{
+   #if AMBIGLASS_FDN_X86
+    #if defined(_MSC_VER) && !defined(__clang__)
+    int info[4] = {};
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osSavesYmm && (info[2] & (1 << 28)) != 0) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+    #else
+    __builtin_cpu_init();
+    const bool sse2 = __builtin_cpu_supports("sse2");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+    #endif
+    if (avx2) return Isa::avx2;
+    if (sse2) return Isa::sse2;
+   #endif
+    return Isa::scalar;
+}
+
+const char* FDNCore::getIsaName(Isa isa)
+{
+    switch (isa) {
+        case Isa::avx2: return "AVX2";
+        case Isa::sse2: return "SSE2";
+        case Isa::scalar: break;
+    }
+    return "scalar";
+}
+
+void FDNCore::Lanes::resize(size_t n)
+{
+    // Room to align the start to 32 bytes
+    storage.assign(n + 8, 0.0f);
+    const auto address = reinterpret_cast<std::uintptr_t>(storage.data());
+    aligned = storage.data() + ((32 - address % 32) % 32) / sizeof(float);
+}
+
+void FDNCore::prepare(int newNumLines, int maxDelay)
+{
+    const std::vector<int> maxDelays(static_cast<size_t>(std::max(newNumLines, 0)), maxDelay);
+    prepare(newNumLines, maxDelays.data());
+}
+
+void FDNCore::prepare(int newNumLines, const int* maxDelays)
+{
+    DelayArena::Region counter;
+    prepare(newNumLines, maxDelays, counter);
+    ownedBuffer.resize(counter.getUsed());
+    buffer = ownedBuffer.data();
+    reset();
+}
+
+void FDNCore::prepare(int newNumLines, const int* maxDelays, DelayArena::Region& memory)
+{
+    assert(newNumLines > 0 && newNumLines % 8 == 0);
+    numLines = newNumLines;
+    const auto n = static_cast<size_t>(numLines);
+
+    // Each line only as long as its own longest delay: one power-of-two block for
+    // all of them would give every line the longest line's length, rounded up
+    lineStart.resize(n);
+    lineLength.resize(n);
+    writePos.resize(n);
+    bufferSize = 0;
+    for (size_t i = 0; i < n; ++i) {
+        lineStart[i] = static_cast<std::int32_t>(bufferSize);
+        lineLength[i] = std::max(maxDelays[i], 4) + 1;
+        bufferSize += static_cast<size_t>(lineLength[i]);
+    }
+    assert(bufferSize <= static_cast<size_t>(INT32_MAX));
+    ownedBuffer = {};
+    buffer = memory.take(bufferSize);
+
+    for (auto* lanes : { &baseDelay, &b0, &b1, &b2, &a1, &a2, &z1, &z2, &readGain, &loopGain,
+                         &inputL, &inputR, &tapL, &tapR, &scratch, &allpassState, &phaseSin, &phaseCos, &delayLimit })
+        lanes->resize(n);
+    for (int i = 0; i < numLines; ++i)
+        at(delayLimit, i) = static_cast<float>(lineLength[static_cast<size_t>(i)] - 3);
+
+    // Pass-through damping and unit gains until the engine sets them
+    for (int i = 0; i < numLines; ++i) {
+        setDamping(i, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+        setGains(i, 1.0f, 0.0f);
+    }
+    // Golden-ratio phase spread: no two lines are near each other in phase
+    for (int i = 0; i < numLines; ++i) {
+        const double angle = 2.0 * 3.14159265358979323846 * std::fmod(0.6180339887 * i, 1.0);
+        at(phaseSin, i) = static_cast<float>(std::sin(angle));
+        at(phaseCos, i) = static_cast<float>(std::cos(angle));
+    }
+
+    setIsa(detectIsa());
+    reset();
+}
+
+void FDNCore::reset()
+{
+    if (buffer != nullptr)
+        std::fill(buffer, buffer + bufferSize, 0.0f);
+    std::fill(z1.storage.begin(), z1.storage.end(), 0.0f);
+    std::fill(z2.storage.begin(), z2.storage.end(), 0.0f);
+    std::fill(allpassState.storage.begin(), allpassState.storage.end(), 0.0f);
+    std::fill(writePos.begin(), writePos.end(), 0);
+}
+
+void FDNCore::setIsa(Isa requested)
+{
+    isa = std::min(requested, detectIsa());
+}
+
+void FDNCore::setDamping(int line, float nb0, float nb1, float nb2, float na1, float na2)
+{
+    at(b0, line) = nb0;
+    at(b1, line) = nb1;
+    at(b2, line) = nb2;
+    at(a1, line) = na1;
+    at(a2, line) = na2;
+}
+
+void FDNCore::setGains(int line, float read, float loop)
+{
+    at(readGain, line) = read;
+    at(loopGain, line) = loop;
+}
+
+void FDNCore::setInputGains(int line, float left, float right)
+{
+    at(inputL, line) = left;
+    at(inputR, line) = right;
+}
+
+void FDNCore::setOutputTaps(int line, float left, float right)
+{
+    at(tapL, line) = left;
+    at(tapR, line) = right;
+}
+
+FDNCore::State FDNCore::makeState()
+{
+    State s;
+    s.numLines = numLines;
+    s.buffer = buffer;
+    s.lineStart = lineStart.data();
+    s.lineLength = lineLength.data();
+    s.writePos = writePos.data();
+    s.delayLimit = delayLimit.data();
+    s.baseDelay = baseDelay.data();
+    s.b0 = b0.data(); s.b1 = b1.data(); s.b2 = b2.data();
+    s.a1 = a1.data(); s.a2 = a2.data();
+    s.z1 = z1.data(); s.z2 = z2.data();
+    s.readGain = readGain.data(); s.loopGain = loopGain.data();
+    s.inputL = inputL.data(); s.inputR = inputR.data();
+    s.tapL = tapL.data(); s.tapR = tapR.data();
+    s.scratch = scratch.data();
+    s.interpolation = interpolation;
+    s.allpassState = allpassState.data();
+    s.phaseSin = phaseSin.data(); s.phaseCos = phaseCos.data();
+    s.modDepth = modDepth;
+    return s;
+}
+
+void FDNCore::process(const float* inL, const float* inR, float* outL, float* outR,
+                      const float* delayScale, const float* lfoSin, const float* lfoCos, int numSamples)
+{
+    if (buffer == nullptr || numSamples <= 0) return;
+
+    auto s = makeState();
+    s.lfoSin = lfoSin;
+    s.lfoCos = lfoCos;
+    if (lfoSin == nullptr || lfoCos == nullptr) {
+        // Any finite samples do at zero depth
+        s.modDepth = 0.0f;
+        s.lfoSin = s.lfoCos = delayScale;
+    }
+    switch (isa) {
+        case Isa::avx2:   FDNCoreKernels::processAVX2(s, inL, inR, outL, outR, delayScale, numSamples); break;
+        case Isa::sse2:   FDNCoreKernels::processSSE2(s, inL, inR, outL, outR, delayScale, numSamples); break;
+        case Isa::scalar: FDNCoreKernels::processScalar(s, inL, inR, outL, outR, delayScale, numSamples); break;
+    }
+}
+
+//==============================================================================
+// Kernels. Each is a template over the interpolation, so the per-sample loops have
+// no branches on it; the public entry points pick the instance once per block.
+// A line's read delay is baseDelay * delayScale[n] * (1 + modDepth * its LFO), held
+// to [minDelay, its line's length - 3] so every interpolation tap (delay - 1 ..
+// delay + 2) stays inside the line's ring and behind its write position. A tap at
+// writePos - d below the ring's start wraps by adding the length (one compare).
+namespace {
+    constexpr float minDelay = 2.0f;
+    // Allpass fractions run over [0.1, 1.1): near 0 the coefficient approaches 1
+    // and the interpolator rings
+    constexpr float allpassOffset = 0.1f;
+
+    template <DelayInterpolation interpolation>
+    float readScalar(FDNCore::State& s, int line, float delay)
+    {
+        const int start = s.lineStart[line], length = s.lineLength[line], writePos = s.writePos[line];
+        const auto tap = [&](int d) {
+            const int pos = writePos - d;
+            return s.buffer[static_cast<size_t>(start + (pos < 0 ? pos + length : pos))];
+        };
+
+        if constexpr (interpolation == DelayInterpolation::none) {
+            return tap(static_cast<int>(delay));
+        } else if constexpr (interpolation == DelayInterpolation::linear) {
+            const int d = static_cast<int>(delay);
+            const float f = delay - static_cast<float>(d);
+            const float x0 = tap(d);
+            return x0 + f * (tap(d + 1) - x0);
+        } else if constexpr (interpolation == DelayInterpolation::lagrange3) {
+            const int d = static_cast<int>(delay);
+            const float f = delay - static_cast<float>(d);
+            const float fp1 = f + 1.0f, fm1 = f - 1.0f, fm2 = f - 2.0f;
+            return -f * fm1 * fm2 * (1.0f / 6.0f) * tap(d - 1) + fp1 * fm1 * fm2 * 0.5f * tap(d)
+                 - fp1 * f * fm2 * 0.5f * tap(d + 1) + fp1 * f * fm1 * (1.0f / 6.0f) * tap(d + 2);
+        } else {
+            const int d = static_cast<int>(delay - allpassOffset);
+            const float f = delay - static_cast<float>(d);
+            const float eta = (1.0f - f) / (1.0f + f);
+            const float y = eta * (tap(d) - s.allpassState[line]) + tap(d + 1);
+            s.allpassState[line] = y;
+            return y;
+        }
+    }
+
+    template <DelayInterpolation interpolation>
+    void processScalarImpl(FDNCore::State& s, const float* inL, const float* inR, float* outL, float* outR,
+                           const float* delayScale, int numSamples)
+    {
+        const int n = s.numLines;
+        const float householder = 2.0f / static_cast<float>(n);
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            const float scale = delayScale[sample];
+            const float modSin = s.modDepth * s.lfoSin[sample], modCos = s.modDepth * s.lfoCos[sample];
+
+            // Modulated reads, damping and read gain
+            float sum = 0.0f;
+            for (int i = 0; i < n; ++i) {
+                const float mod = 1.0f + (modSin * s.phaseCos[i] + modCos * s.phaseSin[i]);
+                const float delay = std::clamp(s.baseDelay[i] * scale * mod, minDelay, s.delayLimit[i]);
+                const float x = readScalar<interpolation>(s, i, delay);
+                float y = s.b0[i] * x + s.z1[i];
+                s.z1[i] = s.b1[i] * x - s.a1[i] * y + s.z2[i];
+                s.z2[i] = s.b2[i] * x - s.a2[i] * y;
+                y *= s.readGain[i];
+                s.scratch[i] = y;
+                sum += y;
+            }
+
+            // Householder mix, output taps and feedback write
+            const float reflected = sum * householder;
+            const float xl = inL[sample], xr = inR[sample];
+            float l = 0.0f, r = 0.0f;
+            for (int i = 0; i < n; ++i) {
+                const float mixed = s.scratch[i] - reflected;
+                l += s.tapL[i] * mixed;
+                r += s.tapR[i] * mixed;
+                s.buffer[static_cast<size_t>(s.lineStart[i] + s.writePos[i])] = s.inputL[i] * xl + s.inputR[i] * xr + mixed * s.loopGain[i];
+                if (++s.writePos[i] == s.lineLength[i])
+                    s.writePos[i] = 0;
+            }
+            outL[sample] = l;
+            outR[sample] = r;
+        }
+    }
+}
+
+void FDNCoreKernels::processScalar(FDNCore::State& s, const float* inL, const float* inR, float* outL, float* outR,
+                                   const float* delayScale, int numSamples)
+{
+    switch (s.interpolation) {
+        case DelayInterpolation::none:      processScalarImpl<DelayInterpolation::none>(s, inL, inR, outL, outR, delayScale, numSamples); break;
+        case DelayInterpolation::linear:    processScalarImpl<DelayInterpolation::linear>(s, inL, inR, outL, outR, delayScale, numSamples); break;
+        case DelayInterpolation::lagrange3: processScalarImpl<DelayInterpolation::lagrange3>(s, inL, inR, outL, outR, delayScale, numSamples); break;
+        case DelayInterpolation::allpass:   processScalarImpl<DelayInterpolation::allpass>(s, inL, inR, outL, outR, delayScale, numSamples); break;
+    }
+}
+
+#if AMBIGLASS_FDN_X86
+namespace {
+    AMBIGLASS_TARGET_SSE2 inline float horizontalSum(__m128 v)
+    {
+        const __m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+    }
+
+    // Four lines' rings: where each is written this sample, its length and its start
+    struct RingsSSE2
+    {
+        __m128i writePos, length, start;
+    };
+
+    AMBIGLASS_TARGET_SSE2 inline RingsSSE2 loadRingsSSE2(const FDNCore::State& s, int line)
+    {
+        return { _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.writePos + line)),
+                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.lineLength + line)),
+                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.lineStart + line)) };
+    }
+
+    // Four lines' samples `delay` frames back (no gather before AVX2)
+    AMBIGLASS_TARGET_SSE2 inline __m128 tapSSE2(const FDNCore::State& s, const RingsSSE2& rings, __m128i delay)
+    {
+        __m128i pos = _mm_sub_epi32(rings.writePos, delay);
+        pos = _mm_add_epi32(pos, _mm_and_si128(_mm_cmplt_epi32(pos, _mm_setzero_si128()), rings.length));
+        alignas(16) std::int32_t index[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(index), _mm_add_epi32(pos, rings.start));
+        return _mm_setr_ps(s.buffer[index[0]], s.buffer[index[1]], s.buffer[index[2]], s.buffer[index[3]]);
+    }
+
+    // Stores four lines' samples at their write positions and advances them
+    AMBIGLASS_TARGET_SSE2 inline void writeSSE2(FDNCore::State& s, int line, __m128 value)
+    {
+        const RingsSSE2 rings = loadRingsSSE2(s, line);
+        alignas(16) std::int32_t index[4];
+        alignas(16) float values[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(index), _mm_add_epi32(rings.writePos, rings.start));
+        _mm_store_ps(values, value);
+        for (int k = 0; k < 4; ++k)
+            s.buffer[index[k]] = values[k];
+        const __m128i next = _mm_add_epi32(rings.writePos, _mm_set1_epi32(1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(s.writePos + line), _mm_andnot_si128(_mm_cmpeq_epi32(next, rings.length), next));
+    }
+
+    template <DelayInterpolation interpolation>
+    AMBIGLASS_TARGET_SSE2 inline __m128 readSSE2(FDNCore::State& s, int line, __m128 delay, const RingsSSE2& rings)
+    {
+        const __m128i one = _mm_set1_epi32(1);
+        if constexpr (interpolation == DelayInterpolation::none) {
+            return tapSSE2(s, rings, _mm_cvttps_epi32(delay));
+        } else if constexpr (interpolation == DelayInterpolation::linear) {
+            const __m128i d = _mm_cvttps_epi32(delay);
+            const __m128 f = _mm_sub_ps(delay, _mm_cvtepi32_ps(d));
+            const __m128 x0 = tapSSE2(s, rings, d);
+            const __m128 x1 = tapSSE2(s, rings, _mm_add_epi32(d, one));
+            return _mm_add_ps(x0, _mm_mul_ps(f, _mm_sub_ps(x1, x0)));
+        } else if constexpr (interpolation == DelayInterpolation::lagrange3) {
+            const __m128i d = _mm_cvttps_epi32(delay);
+            const __m128 f = _mm_sub_ps(delay, _mm_cvtepi32_ps(d));
+            const __m128 fp1 = _mm_add_ps(f, _mm_set1_ps(1.0f)), fm1 = _mm_sub_ps(f, _mm_set1_ps(1.0f)),
+                         fm2 = _mm_sub_ps(f, _mm_set1_ps(2.0f));
+            const __m128 sixth = _mm_set1_ps(1.0f / 6.0f), half = _mm_set1_ps(0.5f);
+            const __m128 h0 = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(f, fm1), fm2), sixth);      // negated
+            const __m128 h1 = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(fp1, fm1), fm2), half);
+            const __m128 h2 = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(fp1, f), fm2), half);       // negated
+            const __m128 h3 = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(fp1, f), fm1), sixth);
+            __m128 x = _mm_sub_ps(_mm_mul_ps(h1, tapSSE2(s, rings, d)),
+                                  _mm_mul_ps(h0, tapSSE2(s, rings, _mm_sub_epi32(d, one))));
+            x = _mm_sub_ps(x, _mm_mul_ps(h2, tapSSE2(s, rings, _mm_add_epi32(d, one))));
+            return _mm_add_ps(x, _mm_mul_ps(h3, tapSSE2(s, rings, _mm_add_epi32(d, _mm_set1_epi32(2)))));
+        } else {
+            const __m128i d = _mm_cvttps_epi32(_mm_sub_ps(delay, _mm_set1_ps(allpassOffset)));
+            const __m128 f = _mm_sub_ps(delay, _mm_cvtepi32_ps(d));
+            const __m128 eta = _mm_div_ps(_mm_sub_ps(_mm_set1_ps(1.0f), f), _mm_add_ps(_mm_set1_ps(1.0f), f));
+            const __m128 x0 = tapSSE2(s, rings, d);
+            const __m128 x1 = tapSSE2(s, rings, _mm_add_epi32(d, one));
+            const __m128 y = _mm_add_ps(_mm_mul_ps(eta, _mm_sub_ps(x0, _mm_load_ps(s.allpassState + line))), x1);
+            _mm_store_ps(s.allpassState + line, y);
+            return y;
+        }
+    }
+
+    template <DelayInterpolation interpolation>
+    AMBIGLASS_TARGET_SSE2
+    void processSSE2Impl(FDNCore::State& s, const float* inL, const float* inR, float* outL, float* outR,
+                         const float* delayScale, int numSamples)
+    {
+        const int n = s.numLines;
+        const __m128 minD = _mm_set1_ps(minDelay);
+        const __m128 one = _mm_set1_ps(1.0f);
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            const __m128 scale = _mm_set1_ps(delayScale[sample]);
+            const __m128 modSin = _mm_set1_ps(s.modDepth * s.lfoSin[sample]), modCos = _mm_set1_ps(s.modDepth * s.lfoCos[sample]);
+
+            __m128 sum = _mm_setzero_ps();
+            for (int i = 0; i < n; i += 4) {
+                const __m128 mod = _mm_add_ps(one, _mm_add_ps(_mm_mul_ps(modSin, _mm_load_ps(s.phaseCos + i)),
+                                                              _mm_mul_ps(modCos, _mm_load_ps(s.phaseSin + i))));
+                __m128 delay = _mm_mul_ps(_mm_mul_ps(_mm_load_ps(s.baseDelay + i), scale), mod);
+                delay = _mm_min_ps(_mm_max_ps(delay, minD), _mm_load_ps(s.delayLimit + i));
+                const __m128 x = readSSE2<interpolation>(s, i, delay, loadRingsSSE2(s, i));
+
+                const __m128 z1 = _mm_load_ps(s.z1 + i), z2 = _mm_load_ps(s.z2 + i);
+                __m128 y = _mm_add_ps(_mm_mul_ps(_mm_load_ps(s.b0 + i), x), z1);
+                _mm_store_ps(s.z1 + i, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_load_ps(s.b1 + i), x),
+                                                             _mm_mul_ps(_mm_load_ps(s.a1 + i), y)), z2));
+                _mm_store_ps(s.z2 + i, _mm_sub_ps(_mm_mul_ps(_mm_load_ps(s.b2 + i), x),
+                                                  _mm_mul_ps(_mm_load_ps(s.a2 + i), y)));
+                y = _mm_mul_ps(y, _mm_load_ps(s.readGain + i));
+                _mm_store_ps(s.scratch + i, y);
+                sum = _mm_add_ps(sum, y);
+            }
+
+            const __m128 reflected = _mm_set1_ps(horizontalSum(sum) * (2.0f / static_cast<float>(n)));
+            const __m128 xl = _mm_set1_ps(inL[sample]), xr = _mm_set1_ps(inR[sample]);
+            __m128 l = _mm_setzero_ps(), r = _mm_setzero_ps();
+            for (int i = 0; i < n; i += 4) {
+                const __m128 mixed = _mm_sub_ps(_mm_load_ps(s.scratch + i), reflected);
+                l = _mm_add_ps(l, _mm_mul_ps(_mm_load_ps(s.tapL + i), mixed));
+                r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(s.tapR + i), mixed));
+                const __m128 in = _mm_add_ps(_mm_mul_ps(_mm_load_ps(s.inputL + i), xl), _mm_mul_ps(_mm_load_ps(s.inputR + i), xr));
+                writeSSE2(s, i, _mm_add_ps(in, _mm_mul_ps(mixed, _mm_load_ps(s.loopGain + i))));
+            }
+            outL[sample] = horizontalSum(l);
+            outR[sample] = horizontalSum(r);
+        }
+    }
+
+    AMBIGLASS_TARGET_AVX2 inline float horizontalSum(__m256 v)
+    {
+        const __m128 quad = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        const __m128 pairs = _mm_add_ps(quad, _mm_movehl_ps(quad, quad));
+        return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+    }
+
+    // Eight lines' rings, as RingsSSE2
+    struct RingsAVX2
+    {
+        __m256i writePos, length, start;
+    };
+
+    AMBIGLASS_TARGET_AVX2 inline RingsAVX2 loadRingsAVX2(const FDNCore::State& s, int line)
+    {
+        return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s.writePos + line)),
+                 _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s.lineLength + line)),
+                 _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s.lineStart + line)) };
+    }
+
+    // Eight lines' samples `delay` frames back, in one gather
+    AMBIGLASS_TARGET_AVX2 inline __m256 tapAVX2(const FDNCore::State& s, const RingsAVX2& rings, __m256i delay)
+    {
+        __m256i pos = _mm256_sub_epi32(rings.writePos, delay);
+        pos = _mm256_add_epi32(pos, _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), pos), rings.length));
+        return _mm256_i32gather_ps(s.buffer, _mm256_add_epi32(pos, rings.start), 4);
+    }
+
+    // Stores eight lines' samples at their write positions (no scatter before
+    // AVX-512) and advances them
+    AMBIGLASS_TARGET_AVX2 inline void writeAVX2(FDNCore::State& s, int line, __m256 value)
+    {
+        const RingsAVX2 rings = loadRingsAVX2(s, line);
+        alignas(32) std::int32_t index[8];
+        alignas(32) float values[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(index), _mm256_add_epi32(rings.writePos, rings.start));
+        _mm256_store_ps(values, value);
+        for (int k = 0; k < 8; ++k)
+            s.buffer[index[k]] = values[k];
+        const __m256i next = _mm256_add_epi32(rings.writePos, _mm256_set1_epi32(1));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(s.writePos + line),
+                            _mm256_andnot_si256(_mm256_cmpeq_epi32(next, rings.length), next));
+    }
+
+    template <DelayInterpolation interpolation>
+    AMBIGLASS_TARGET_AVX2 inline __m256 readAVX2(FDNCore::State& s, int line, __m256 delay, const RingsAVX2& rings)
+    {
+        const __m256i one = _mm256_set1_epi32(1);
+        if constexpr (interpolation == DelayInterpolation::none) {
+            return tapAVX2(s, rings, _mm256_cvttps_epi32(delay));
+        } else if constexpr (interpolation == DelayInterpolation::linear) {
+            const __m256i d = _mm256_cvttps_epi32(delay);
+            const __m256 f = _mm256_sub_ps(delay, _mm256_cvtepi32_ps(d));
+            const __m256 x0 = tapAVX2(s, rings, d);
+            const __m256 x1 = tapAVX2(s, rings, _mm256_add_epi32(d, one));
+            return _mm256_add_ps(x0, _mm256_mul_ps(f, _mm256_sub_ps(x1, x0)));
+        } else if constexpr (interpolation == DelayInterpolation::lagrange3) {
+            const __m256i d = _mm256_cvttps_epi32(delay);
+            const __m256 f = _mm256_sub_ps(delay, _mm256_cvtepi32_ps(d));
+            const __m256 fp1 = _mm256_add_ps(f, _mm256_set1_ps(1.0f)), fm1 = _mm256_sub_ps(f, _mm256_set1_ps(1.0f)),
+                         fm2 = _mm256_sub_ps(f, _mm256_set1_ps(2.0f));
+            const __m256 sixth = _mm256_set1_ps(1.0f / 6.0f), half = _mm256_set1_ps(0.5f);
+            const __m256 h0 = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(f, fm1), fm2), sixth);      // negated
+            const __m256 h1 = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(fp1, fm1), fm2), half);
+            const __m256 h2 = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(fp1, f), fm2), half);       // negated
+            const __m256 h3 = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(fp1, f), fm1), sixth);
+            __m256 x = _mm256_sub_ps(_mm256_mul_ps(h1, tapAVX2(s, rings, d)),
+                                     _mm256_mul_ps(h0, tapAVX2(s, rings, _mm256_sub_epi32(d, one))));
+            x = _mm256_sub_ps(x, _mm256_mul_ps(h2, tapAVX2(s, rings, _mm256_add_epi32(d, one))));
+            return _mm256_add_ps(x, _mm256_mul_ps(h3, tapAVX2(s, rings, _mm256_add_epi32(d, _mm256_set1_epi32(2)))));
+        } else {
+            const __m256i d = _mm256_cvttps_epi32(_mm256_sub_ps(delay, _mm256_set1_ps(allpassOffset)));
+            const __m256 f = _mm256_sub_ps(delay, _mm256_cvtepi32_ps(d));
+            const __m256 eta = _mm256_div_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), f), _mm256_add_ps(_mm256_set1_ps(1.0f), f));
+            const __m256 x0 = tapAVX2(s, rings, d);
+            const __m256 x1 = tapAVX2(s, rings, _mm256_add_epi32(d, one));
+            const __m256 y = _mm256_add_ps(_mm256_mul_ps(eta, _mm256_sub_ps(x0, _mm256_load_ps(s.allpassState + line))), x1);
+            _mm256_store_ps(s.allpassState + line, y);
+            return y;
+        }
+    }
+
+    template <DelayInterpolation interpolation>
+    AMBIGLASS_TARGET_AVX2
+    void processAVX2Impl(FDNCore::State& s, const float* inL, const float* inR, float* outL, float* outR,
+                         const float* delayScale, int numSamples)
+    {
+        const int n = s.numLines;
+        const __m256 minD = _mm256_set1_ps(minDelay);
+        const __m256 one = _mm256_set1_ps(1.0f);
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            const __m256 scale = _mm256_set1_ps(delayScale[sample]);
+            const __m256 modSin = _mm256_set1_ps(s.modDepth * s.lfoSin[sample]),
+                         modCos = _mm256_set1_ps(s.modDepth * s.lfoCos[sample]);
+
+            __m256 sum = _mm256_setzero_ps();
+            for (int i = 0; i < n; i += 8) {
+                const __m256 mod = _mm256_add_ps(one, _mm256_add_ps(_mm256_mul_ps(modSin, _mm256_load_ps(s.phaseCos + i)),
+                                                                    _mm256_mul_ps(modCos, _mm256_load_ps(s.phaseSin + i))));
+                __m256 delay = _mm256_mul_ps(_mm256_mul_ps(_mm256_load_ps(s.baseDelay + i), scale), mod);
+                delay = _mm256_min_ps(_mm256_max_ps(delay, minD), _mm256_load_ps(s.delayLimit + i));
+                const __m256 x = readAVX2<interpolation>(s, i, delay, loadRingsAVX2(s, i));
+
+                const __m256 z1 = _mm256_load_ps(s.z1 + i), z2 = _mm256_load_ps(s.z2 + i);
+                __m256 y = _mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(s.b0 + i), x), z1);
+                _mm256_store_ps(s.z1 + i, _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_load_ps(s.b1 + i), x),
+                                                                      _mm256_mul_ps(_mm256_load_ps(s.a1 + i), y)), z2));
+                _mm256_store_ps(s.z2 + i, _mm256_sub_ps(_mm256_mul_ps(_mm256_load_ps(s.b2 + i), x),
+                                                        _mm256_mul_ps(_mm256_load_ps(s.a2 + i), y)));
+                y = _mm256_mul_ps(y, _mm256_load_ps(s.readGain + i));
+                _mm256_store_ps(s.scratch + i, y);
+                sum = _mm256_add_ps(sum, y);
+            }
+
+            const __m256 reflected = _mm256_set1_ps(horizontalSum(sum) * (2.0f / static_cast<float>(n)));
+            const __m256 xl = _mm256_set1_ps(inL[sample]), xr = _mm256_set1_ps(inR[sample]);
+            __m256 l = _mm256_setzero_ps(), r = _mm256_setzero_ps();
+            for (int i = 0; i < n; i += 8) {
+                const __m256 mixed = _mm256_sub_ps(_mm256_load_ps(s.scratch + i), reflected);
+                l = _mm256_add_ps(l, _mm256_mul_ps(_mm256_load_ps(s.tapL + i), mixed));
+                r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_load_ps(s.tapR + i), mixed));
+                const __m256 in = _mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(s.inputL + i), xl),
+                                                _mm256_mul_ps(_mm256_load_ps(s.inputR + i), xr));
+                writeAVX2(s, i, _mm256_add_ps(in, _mm256_mul_ps(mixed, _mm256_load_ps(s.loopGain + i))));
+            }
+            outL[sample] = horizontalSum(l);
+            outR[sample] = horizontalSum(r);
+        }
+    }
+}
+
+void FDNCoreKernels::processSSE2(FDNCore::State& s, const float* inL, const float* inR, float* outL, float* outR,
+                                 const float* delayScale, int numSamples)
+{
+    switch (s.interpolation) {
+        case DelayInterpolation::none:      processSSE2Impl<DelayInterpolation::none>(s, inL, inR, outL, outR, delayScale, numSamples); break;
+        case DelayInterpolation::linear:    processSSE2Impl<DelayInterpolation::linear>(s, inL, inR, outL, outR, delayScale, numSamples); break;
+        case DelayInterpolation::lagrange3: processSSE2Impl<DelayInterpolation::lagrange3>(s, inL, inR, outL, outR, delayScale, numSamples); break;
+        case DelayInterpolation::allpass:   processSSE2Impl<DelayInterpolation::allpass>(s, inL, inR, outL, outR, delayScale, numSamples); break;
+    }
+}
+
+void FDNCoreKernels::processAVX2(FDNCore::State& s, const float* inL, const float* inR, float* outL, float* outR,
+                                 const float* delayScale, int numSamples)
+{
+    switch (s.interpolation) {
+        case DelayInterpolation::none:      processAVX2Impl<DelayInterpolation::none>(s, inL, inR, outL, outR, delayScale, numSamples); break;
+        case DelayInterpolation::linear:    processAVX2Impl<DelayInterpolation::linear>(s, inL, inR, outL, outR, delayScale, numSamples); break;
+        case DelayInterpolation::lagrange3: processAVX2Impl<DelayInterpolation::lagrange3>(s, inL, inR, outL, outR, delayScale, numSamples); break;
+        case DelayInterpolation::allpass:   processAVX2Impl<DelayInterpolation::allpass>(s, inL, inR, outL, outR, delayScale, numSamples); break;
+    }
+}
+#else
+// No x86 vector units: detectIsa() never selects these
+void FDNCoreKernels::processSSE2(FDNCore::State& s, const float* inL, const float* inR, float* outL, float* outR,
+                                 const float* delayScale, int numSamples)
+{
+    processScalar(s, inL, inR, outL, outR, delayScale, numSamples);
+}
+
+void FDNCoreKernels::processAVX2(FDNCore::State& s, const float* inL, const float* inR, float* outL, float* outR,
+                                 const float* delayScale, int numSamples)
+{
+    processScalar(s, inL, inR, outL, outR, delayScale, numSamples);
+}
+#endif
@@ -0,0 +1,130 @@
+#pragma once
+#include "DelayArena.h"
+#include "MaskedDelayLine.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Structure-of-arrays core for the Householder FDN engines (Hall, Plate).
+// Per sample and line: modulated, interpolated delay read -> biquad damping -> read gain ->
+// Householder mix -> L/R output taps -> write (L/R input gains + mixed * loop gain).
+//
+// All per-line state is stored as contiguous arrays, so 4 (SSE2) or 8 (AVX2) lines
+// are processed per instruction. Each delay line is its own ring, sized to the
+// longest delay that line can be asked for and packed back to back in one buffer;
+// the modulated reads are gathers and the writes scatter one sample per line. The implementation is picked at runtime from what
+// the CPU supports; the scalar path is the reference the vector paths are tested
+// against (they differ only in summation order).
+// No JUCE dependency; nothing in process() allocates or locks.
+class FDNCore
+{
+public:
+    enum class Isa { scalar, sse2, avx2 };
+
+    // Best implementation this CPU supports
+    static Isa detectIsa();
+    static const char* getIsaName(Isa isa);
+
+    // numLines must be a multiple of 8; every line holds delays up to maxDelay samples.
+    // Not real-time safe.
+    void prepare(int numLines, int maxDelay);
+    // As above, line i holding delays up to maxDelays[i] samples
+    void prepare(int numLines, const int* maxDelays);
+    // As above, with the delay memory taken from an arena region. A counting region
+    // only records the size; the core must be prepared again before use.
+    void prepare(int numLines, const int* maxDelays, DelayArena::Region& memory);
+    void reset();
+    // Defaults to detectIsa(); an unsupported choice falls back to the best supported one
+    void setIsa(Isa isa);
+    Isa getIsa() const { return isa; }
+    int getNumLines() const { return numLines; }
+    // Samples in a line's ring, maxDelay + 1
+    int getLineLength(int line) const { return lineLength[static_cast<size_t>(line)]; }
+
+    // Setters only write the per-line arrays, so they may be called between blocks
+    void setBaseDelay(int line, float samples) { at(baseDelay, line) = samples; }
+    // Normalised biquad (a0 = 1), transposed direct form II like juce::dsp::IIR::Filter
+    void setDamping(int line, float b0, float b1, float b2, float a1, float a2);
+    // readGain scales the filtered read, loopGain the mixed signal fed back
+    void setGains(int line, float readGain, float loopGain);
+    void setInputGains(int line, float left, float right);
+    void setOutputTaps(int line, float left, float right);
+    // How the fractional delays are read; defaults to third-order Lagrange
+    void setInterpolation(DelayInterpolation newInterpolation) { interpolation = newInterpolation; }
+    DelayInterpolation getInterpolation() const { return interpolation; }
+    // Relative depth of the delay modulation (0.001 = 0.1%)
+    void setModulationDepth(float depth) { modDepth = depth; }
+
+    // Reads inL/inR and writes the wet outL/outR. Each line delays by
+    // base delay * delayScale[n] * (1 + depth * lfo) samples, limited to
+    // [2, line length - 3] and read with the set interpolation. lfoSin/lfoCos is
+    // one quadrature sine (e.g. LfoBank's); every line follows it at its own phase
+    // offset, spread by the golden ratio so no two lines' pitch wobbles line up.
+    // Without one (nullptr) the delays are not modulated.
+    void process(const float* inL, const float* inR, float* outL, float* outR,
+                 const float* delayScale, const float* lfoSin, const float* lfoCos, int numSamples);
+
+    // Per-line state and delay memory shared by the scalar and vector implementations
+    struct State
+    {
+        int numLines = 0;
+        float* buffer = nullptr;      // the lines' rings, back to back
+        // Per line: where its ring starts in buffer, the ring's length and where
+        // this sample is written (reads wrap by adding the length, not a mask)
+        const std::int32_t* lineStart = nullptr;
+        const std::int32_t* lineLength = nullptr;
+        std::int32_t* writePos = nullptr;
+        const float* delayLimit = nullptr;  // longest read delay, length - 3
+        const float* baseDelay = nullptr;
+        const float* b0 = nullptr; const float* b1 = nullptr; const float* b2 = nullptr;
+        const float* a1 = nullptr; const float* a2 = nullptr;
+        float* z1 = nullptr; float* z2 = nullptr;
+        const float* readGain = nullptr; const float* loopGain = nullptr;
+        const float* inputL = nullptr; const float* inputR = nullptr;
+        const float* tapL = nullptr; const float* tapR = nullptr;
+        float* scratch = nullptr;     // numLines, for the mixed vector
+        DelayInterpolation interpolation = DelayInterpolation::lagrange3;
+        float* allpassState = nullptr;
+        // Per sample: the shared LFO's (sin, cos); per line: its phase offset's
+        const float* lfoSin = nullptr; const float* lfoCos = nullptr;
+        const float* phaseSin = nullptr; const float* phaseCos = nullptr;
+        float modDepth = 0.0f;
+    };
+
+private:
+    // 32-byte aligned float array
+    struct Lanes
+    {
+        void resize(size_t n);
+        float* data() { return aligned; }
+        const float* data() const { return aligned; }
+        float& operator[](size_t i) { return aligned[i]; }
+        std::vector<float> storage;
+        float* aligned = nullptr;
+    };
+
+    float& at(Lanes& lanes, int line) { return lanes[static_cast<size_t>(line)]; }
+    State makeState();
+
+    Isa isa = Isa::scalar;
+    int numLines = 0;
+    float* buffer = nullptr;      // sum of the line lengths, owned or in an arena
+    size_t bufferSize = 0;
+    Lanes ownedBuffer;
+    Lanes baseDelay, b0, b1, b2, a1, a2, z1, z2, readGain, loopGain;
+    Lanes inputL, inputR, tapL, tapR, scratch;
+    Lanes allpassState, phaseSin, phaseCos, delayLimit;
+    std::vector<std::int32_t> lineStart, lineLength, writePos;
+    DelayInterpolation interpolation = DelayInterpolation::lagrange3;
+    float modDepth = 0.0f;
+};
+
+namespace FDNCoreKernels
+{
+    void processScalar(FDNCore::State& s, const float* inL, const float* inR, float* outL, float* outR,
+                       const float* delayScale, int numSamples);
+    void processSSE2(FDNCore::State& s, const float* inL, const float* inR, float* outL, float* outR,
+                     const float* delayScale, int numSamples);
+    void processAVX2(FDNCore::State& s, const float* inL, const float* inR, float* outL, float* outR,
+                     const float* delayScale, int numSamples);
+}
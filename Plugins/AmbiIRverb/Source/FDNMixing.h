@@ -0,0 +1,94 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+// Feedback matrices for the FDN engines, applied in O(N) or O(N log N) instead of
+// a dense N x N multiply. Sized at compile time so the loops unroll. No JUCE
+// dependency, so the kernels can be tested on their own.
+namespace FDNMixing
+{
+    template <int N>
+    using Matrix = std::array<std::array<float, N>, N>;
+
+    // Householder reflection H = I - (2/N) * 1 * 1^T: out = in - (2/N) * sum(in).
+    // Lossless for any N; in and out may alias.
+    template <int N>
+    struct Householder
+    {
+        static_assert(N > 0, "Householder needs at least one line");
+
+        static void apply(const float* in, float* out)
+        {
+            float sum = 0.0f;
+            for (int i = 0; i < N; ++i)
+                sum += in[i];
+            const float reflected = sum * (2.0f / static_cast<float>(N));
+            for (int i = 0; i < N; ++i)
+                out[i] = in[i] - reflected;
+        }
+
+        static Matrix<N> dense()
+        {
+            Matrix<N> m;
+            for (int i = 0; i < N; ++i)
+                for (int j = 0; j < N; ++j)
+                    m[static_cast<size_t>(i)][static_cast<size_t>(j)] = (i == j ? 1.0f : 0.0f) - 2.0f / static_cast<float>(N);
+            return m;
+        }
+    };
+
+    // Normalised Sylvester Hadamard matrix, H[i][j] = (-1)^popcount(i & j) / sqrt(N),
+    // applied with an in-place butterfly (fast Walsh-Hadamard transform, natural order).
+    // Orthogonal, so lossless; in and out may alias.
+    template <int N>
+    struct Hadamard
+    {
+        static_assert(N > 0 && (N & (N - 1)) == 0, "Hadamard size must be a power of two");
+
+        static void apply(const float* in, float* out)
+        {
+            if (out != in)
+                for (int i = 0; i < N; ++i)
+                    out[i] = in[i];
+
+            for (int h = 1; h < N; h *= 2)
+                for (int i = 0; i < N; i += 2 * h)
+                    for (int j = i; j < i + h; ++j) {
+                        const float a = out[j], b = out[j + h];
+                        out[j] = a + b;
+                        out[j + h] = a - b;
+                    }
+
+            const float scale = 1.0f / std::sqrt(static_cast<float>(N));
+            for (int i = 0; i < N; ++i)
+                out[i] *= scale;
+        }
+
+        static Matrix<N> dense()
+        {
+            const float scale = 1.0f / std::sqrt(static_cast<float>(N));
+            Matrix<N> m;
+            for (int i = 0; i < N; ++i)
+                for (int j = 0; j < N; ++j) {
+                    int parity = 0;
+                    for (int bits = i & j; bits != 0; bits &= bits - 1)
+                        parity ^= 1;
+                    m[static_cast<size_t>(i)][static_cast<size_t>(j)] = parity ? -scale : scale;
+                }
+            return m;
+        }
+    };
+
+    // Reference dense multiply, out = m * in
+    template <int N>
+    void applyDense(const Matrix<N>& m, const float* in, float* out)
+    {
+        for (int i = 0; i < N; ++i) {
+            float sum = 0.0f;
+            for (int j = 0; j < N; ++j)
+                sum += m[static_cast<size_t>(i)][static_cast<size_t>(j)] * in[j];
+            out[i] = sum;
+        }
+    }
+}
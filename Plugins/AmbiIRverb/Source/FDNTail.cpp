@@ -0,0 +1,283 @@
+#include "FDNTail.h"
+
+namespace {
+    using Coefficients = juce::dsp::IIR::Coefficients<float>;
+
+    bool isPrime(int n)
+    {
+        if (n < 2) return false;
+        for (int d = 2; d * d <= n; ++d)
+            if (n % d == 0) return false;
+        return true;
+    }
+
+    // Measures one band well inside its shelf region (an octave away from the
+    // crossovers) so the band's own decay is not masked by its neighbours
+    struct BandFilter
+    {
+        BandFilter(int band, double sampleRate)
+        {
+            const float low = FDNTail::lowCrossover * 0.5f, high = FDNTail::highCrossover * 2.0f;
+            const float mid = std::sqrt(FDNTail::lowCrossover * FDNTail::highCrossover);
+            if (band == 0) {
+                first.coefficients = Coefficients::makeLowPass(sampleRate, low);
+                second.coefficients = Coefficients::makeLowPass(sampleRate, low);
+            } else if (band == 1) {
+                first.coefficients = Coefficients::makeHighPass(sampleRate, mid * 0.7f);
+                second.coefficients = Coefficients::makeLowPass(sampleRate, mid * 1.4f);
+            } else {
+                first.coefficients = Coefficients::makeHighPass(sampleRate, juce::jmin(high, static_cast<float>(sampleRate * 0.4)));
+                second.coefficients = Coefficients::makeHighPass(sampleRate, juce::jmin(high, static_cast<float>(sampleRate * 0.4)));
+            }
+        }
+        float processSample(float x) { return second.processSample(first.processSample(x)); }
+
+        juce::dsp::IIR::Filter<float> first, second;
+    };
+
+    std::array<double, FDNTail::numBands> bandEnergies(const float* data, int numSamples, double sampleRate)
+    {
+        std::array<double, FDNTail::numBands> energy {};
+        for (int band = 0; band < FDNTail::numBands; ++band) {
+            BandFilter filter(band, sampleRate);
+            for (int i = 0; i < numSamples; ++i) {
+                const float y = filter.processSample(data[i]);
+                energy[static_cast<size_t>(band)] += static_cast<double>(y) * y;
+            }
+        }
+        return energy;
+    }
+
+    // Decay rate of one band in dB per sample: line fit to the Schroeder integral
+    // between -5 dB and -25 dB (or as far as the band goes)
+    double bandDecaySlope(const std::vector<float>& band)
+    {
+        std::vector<double> edc(band.size());
+        double sum = 0.0;
+        for (size_t i = band.size(); i-- > 0;) {
+            sum += static_cast<double>(band[i]) * band[i];
+            edc[i] = sum;
+        }
+        if (sum <= 0.0) return 0.0;
+
+        double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+        int n = 0;
+        const size_t step = juce::jmax<size_t>(1, band.size() / 4096);
+        for (size_t i = 0; i < band.size(); i += step) {
+            const double db = 10.0 * std::log10(juce::jmax(edc[i], 1.0e-30) / sum);
+            if (db > -5.0) continue;
+            if (db < -25.0) break;
+            const double x = static_cast<double>(i);
+            sx += x; sy += db; sxx += x * x; sxy += x * db;
+            ++n;
+        }
+        if (n < 2) return 0.0;
+        return (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    }
+}
+
+std::array<int, FDNTail::numLines> FDNTail::lineLengths(double sampleRate)
+{
+    // 30-100 ms, mutually prime so the echoes do not pile up
+    static constexpr std::array<double, numLines> lengthsMs {
+        29.7, 31.3, 34.1, 37.9, 41.3, 43.9, 47.3, 53.1,
+        57.7, 61.1, 67.3, 71.9, 77.3, 83.9, 89.3, 97.1
+    };
+    std::array<int, numLines> lengths {};
+    for (int i = 0; i < numLines; ++i) {
+        int n = static_cast<int>(lengthsMs[static_cast<size_t>(i)] * sampleRate / 1000.0);
+        while (!isPrime(n)) ++n;
+        lengths[static_cast<size_t>(i)] = n;
+    }
+    return lengths;
+}
+
+FDNTail::Settings FDNTail::analyse(const juce::AudioBuffer<float>& ir, const std::vector<std::vector<int>>& outputChannels,
+                                   int cutoff, int fadeLength, double sampleRate)
+{
+    Settings result;
+    result.sampleRate = sampleRate;
+    const int numOutputs = static_cast<int>(outputChannels.size());
+    const int tailLength = ir.getNumSamples() - cutoff;
+    jassert(tailLength > 0 && cutoff >= fadeLength);
+
+    // Per-band RT60 of the tail, all channels together
+    std::vector<float> mixed(static_cast<size_t>(tailLength), 0.0f);
+    for (int ch = 0; ch < ir.getNumChannels(); ++ch)
+        juce::FloatVectorOperations::add(mixed.data(), ir.getReadPointer(ch, cutoff), tailLength);
+
+    for (int band = 0; band < numBands; ++band) {
+        BandFilter filter(band, sampleRate);
+        std::vector<float> filtered(mixed.size());
+        for (size_t i = 0; i < mixed.size(); ++i)
+            filtered[i] = filter.processSample(mixed[i]);
+
+        const double slope = bandDecaySlope(filtered);
+        result.rt60[static_cast<size_t>(band)] = slope < 0.0 ? juce::jlimit(0.05f, 30.0f, static_cast<float>(-60.0 / slope / sampleRate))
+                                                             : 1.0f;
+    }
+
+    // The network's first echo arrives one (shortest) line after its input,
+    // so it starts building up as the early part starts fading out
+    const int shortestLine = lineLengths(sampleRate)[0];
+    result.predelay = juce::jmax(0, cutoff - fadeLength - shortestLine);
+
+    // Calibrate: run a unit-gain network on an impulse and compare band energies with
+    // the IR over the 100 ms after the cutoff. Every input feeds every output with
+    // 1 / sqrt(numInputs), so for uncorrelated inputs an output carries the unit
+    // response's energy times its gain^2, against the sum of its paths' energies.
+    const int window = juce::jmin(tailLength, static_cast<int>(sampleRate * 0.1));
+    const int calibrationLength = cutoff + window;
+    Settings unit = result;
+    unit.outputGains.assign(static_cast<size_t>(numOutputs * numBands), 1.0f);
+
+    FDNTail probe;
+    probe.prepare(unit, 1, numOutputs);
+    juce::AudioBuffer<float> response(numOutputs, calibrationLength);
+    response.clear();
+    std::vector<float> impulse(static_cast<size_t>(calibrationLength), 0.0f);
+    impulse[0] = 1.0f;
+    const float* probeInput = impulse.data();
+    probe.process(&probeInput, response.getArrayOfWritePointers(), calibrationLength);
+
+    result.outputGains.assign(static_cast<size_t>(numOutputs * numBands), 0.0f);
+    for (int out = 0; out < numOutputs; ++out) {
+        std::array<double, numBands> irEnergy {};
+        for (int ch : outputChannels[static_cast<size_t>(out)]) {
+            const auto pathEnergy = bandEnergies(ir.getReadPointer(ch, cutoff), window, sampleRate);
+            for (int band = 0; band < numBands; ++band)
+                irEnergy[static_cast<size_t>(band)] += pathEnergy[static_cast<size_t>(band)];
+        }
+
+        const auto fdnEnergy = bandEnergies(response.getReadPointer(out, cutoff), window, sampleRate);
+        for (int band = 0; band < numBands; ++band) {
+            const double ratio = fdnEnergy[static_cast<size_t>(band)] > 0.0
+                               ? irEnergy[static_cast<size_t>(band)] / fdnEnergy[static_cast<size_t>(band)] : 0.0;
+            result.outputGains[static_cast<size_t>(out * numBands + band)] = static_cast<float>(std::sqrt(ratio));
+        }
+    }
+    return result;
+}
+
+void FDNTail::prepare(const Settings& newSettings, int newNumInputs, int numOutputs)
+{
+    settings = newSettings;
+    numInputs = newNumInputs;
+    inputGain = 1.0f / std::sqrt(static_cast<float>(juce::jmax(1, numInputs)));
+    const double sr = settings.sampleRate;
+
+    predelayBuffer.assign(static_cast<size_t>(juce::jmax(1, settings.predelay)), 0.0f);
+
+    // Per-line band gains for RT60: g = 10^(-3 * length / (RT60 * sr))
+    const auto lengths = lineLengths(sr);
+    for (int l = 0; l < numLines; ++l) {
+        auto& line = lines[static_cast<size_t>(l)];
+        const int length = lengths[static_cast<size_t>(l)];
+        line.buffer.assign(static_cast<size_t>(length), 0.0f);
+        std::array<float, numBands> g {};
+        for (int band = 0; band < numBands; ++band)
+            g[static_cast<size_t>(band)] = std::pow(10.0f, -3.0f * static_cast<float>(length)
+                                                          / (settings.rt60[static_cast<size_t>(band)] * static_cast<float>(sr)));
+        line.gain = g[1];
+        line.lowShelf.coefficients = Coefficients::makeLowShelf(sr, lowCrossover, 0.707f, g[0] / g[1]);
+        line.highShelf.coefficients = Coefficients::makeHighShelf(sr, highCrossover, 0.707f, g[2] / g[1]);
+    }
+
+    // Walsh-Hadamard rows 1.. as output taps (row 0 would correlate every output)
+    outputs.resize(static_cast<size_t>(numOutputs));
+    const float tapScale = 1.0f / std::sqrt(static_cast<float>(numLines));
+    for (int out = 0; out < numOutputs; ++out) {
+        auto& o = outputs[static_cast<size_t>(out)];
+        const int row = (out % (numLines - 1)) + 1;
+        for (int l = 0; l < numLines; ++l)
+            o.taps[static_cast<size_t>(l)] = (juce::countNumberOfBits(static_cast<juce::uint32>(row & l)) & 1) ? -tapScale : tapScale;
+
+        const auto gainAt = [&](int band) {
+            const size_t index = static_cast<size_t>(out * numBands + band);
+            return juce::jmax(1.0e-6f, index < settings.outputGains.size() ? settings.outputGains[index] : 1.0f);
+        };
+        o.gain = gainAt(1);
+        o.lowShelf.coefficients = Coefficients::makeLowShelf(sr, lowCrossover, 0.707f, gainAt(0) / gainAt(1));
+        o.highShelf.coefficients = Coefficients::makeHighShelf(sr, highCrossover, 0.707f, gainAt(2) / gainAt(1));
+    }
+
+    reset();
+}
+
+void FDNTail::reset()
+{
+    std::fill(predelayBuffer.begin(), predelayBuffer.end(), 0.0f);
+    predelayPos = 0;
+    for (auto& line : lines) {
+        std::fill(line.buffer.begin(), line.buffer.end(), 0.0f);
+        line.pos = 0;
+        line.lowShelf.reset();
+        line.highShelf.reset();
+    }
+    for (auto& o : outputs) {
+        o.lowShelf.reset();
+        o.highShelf.reset();
+    }
+}
+
+void FDNTail::process(const float* const* inputs, float* const* outs, int numSamples)
+{
+    const int numOutputs = static_cast<int>(outputs.size());
+    const float householder = 2.0f / static_cast<float>(numLines);
+    const int predelayLength = static_cast<int>(predelayBuffer.size());
+
+    for (int i = 0; i < numSamples; ++i) {
+        float x = 0.0f;
+        for (int in = 0; in < numInputs; ++in)
+            x += inputs[in][i];
+        x *= inputGain;
+
+        if (settings.predelay > 0) {
+            const float delayed = predelayBuffer[static_cast<size_t>(predelayPos)];
+            predelayBuffer[static_cast<size_t>(predelayPos)] = x;
+            predelayPos = predelayPos + 1 < predelayLength ? predelayPos + 1 : 0;
+            x = delayed;
+        }
+
+        // Line outputs through their band attenuation
+        std::array<float, numLines> s;
+        float sum = 0.0f;
+        for (int l = 0; l < numLines; ++l) {
+            auto& line = lines[static_cast<size_t>(l)];
+            const float y = line.buffer[static_cast<size_t>(line.pos)] * line.gain;
+            s[static_cast<size_t>(l)] = line.highShelf.processSample(line.lowShelf.processSample(y));
+            sum += s[static_cast<size_t>(l)];
+        }
+
+        for (int out = 0; out < numOutputs; ++out) {
+            auto& o = outputs[static_cast<size_t>(out)];
+            float y = 0.0f;
+            for (int l = 0; l < numLines; ++l)
+                y += o.taps[static_cast<size_t>(l)] * s[static_cast<size_t>(l)];
+            outs[out][i] += o.highShelf.processSample(o.lowShelf.processSample(y * o.gain));
+        }
+
+        // Householder feedback, O(N): s - (2/N) * sum(s); input enters every line
+        // with alternating sign
+        const float reflected = householder * sum;
+        for (int l = 0; l < numLines; ++l) {
+            auto& line = lines[static_cast<size_t>(l)];
+            line.buffer[static_cast<size_t>(line.pos)] = s[static_cast<size_t>(l)] - reflected + ((l & 1) ? -x : x);
+            line.pos = line.pos + 1 < static_cast<int>(line.buffer.size()) ? line.pos + 1 : 0;
+        }
+    }
+}
+
+int FDNTail::getMemorySamples() const
+{
+    size_t longest = 0;
+    for (const auto& line : lines)
+        longest = juce::jmax(longest, line.buffer.size());
+    return settings.predelay + static_cast<int>(longest);
+}
+
+int FDNTail::getDecaySamples() const
+{
+    const float rt60 = *std::max_element(settings.rt60.begin(), settings.rt60.end());
+    return settings.predelay + static_cast<int>(std::ceil(rt60 * settings.sampleRate));
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <JuceHeader.h>
+
+// Feedback delay network that stands in for the late part of a long IR.
+// 16 lines with a Householder feedback matrix; each line attenuates three bands
+// (split at 500 Hz and 4 kHz) through a gain and two shelves so the tail decays with
+// the IR's per-band RT60. Each output has its own Walsh-Hadamard tap vector (so the
+// outputs are decorrelated) and a three-band EQ matching the IR's tail energy.
+// All inputs are summed into the network; the late field is diffuse anyway.
+class FDNTail
+{
+public:
+    static constexpr int numLines = 16;
+    static constexpr int numBands = 3;
+    static constexpr float lowCrossover = 500.0f;
+    static constexpr float highCrossover = 4000.0f;
+
+    struct Settings
+    {
+        double sampleRate = 48000.0;
+        int predelay = 0;                          // Samples before the network input
+        std::array<float, numBands> rt60 { 1.0f, 1.0f, 1.0f };
+        std::vector<float> outputGains;            // [output][band]
+    };
+
+    // Measures the per-band decay of ir from `cutoff` on and calibrates a network whose
+    // output fades in under a raised-cosine fade of the early part over
+    // [cutoff - fadeLength, cutoff) and matches the IR's band energies after it
+    // (for uncorrelated inputs). outputChannels[o] lists the IR channels feeding
+    // output o. Not real-time safe.
+    static Settings analyse(const juce::AudioBuffer<float>& ir, const std::vector<std::vector<int>>& outputChannels,
+                            int cutoff, int fadeLength, double sampleRate);
+
+    // Not real-time safe
+    void prepare(const Settings& settings, int numInputs, int numOutputs);
+    void reset();
+
+    // Adds the tail to outputs
+    void process(const float* const* inputs, float* const* outputs, int numSamples);
+
+    const Settings& getSettings() const { return settings; }
+    // Predelay plus the longest line: once input and output have been silent this
+    // long, so are the lines
+    int getMemorySamples() const;
+    // Predelay plus the slowest band's RT60
+    int getDecaySamples() const;
+
+private:
+    struct Line
+    {
+        std::vector<float> buffer;   // Exactly the line length; read then overwritten
+        int pos = 0;
+        float gain = 1.0f;
+        juce::dsp::IIR::Filter<float> lowShelf, highShelf;
+    };
+
+    struct Output
+    {
+        std::array<float, numLines> taps {};
+        float gain = 1.0f;
+        juce::dsp::IIR::Filter<float> lowShelf, highShelf;
+    };
+
+    static std::array<int, numLines> lineLengths(double sampleRate);
+
+    Settings settings;
+    int numInputs = 0;
+    float inputGain = 1.0f;
+    std::vector<float> predelayBuffer;
+    int predelayPos = 0;
+    std::array<Line, numLines> lines;
+    std::vector<Output> outputs;
+};
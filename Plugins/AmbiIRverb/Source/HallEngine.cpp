@@ -4,47 +4,58 @@
 HallEngine::HallEngine()
 {
     params.timeScale = 1.0f;
-    params.diffusion = 0.65f;
+    params.diffusion = 65.0f;
     params.width = 1.0f;
     params.modDepth = 0.0f;
-    params.modRate = 0.3f;
+    params.modRateHz = 0.3f;
     
-    // Initialize Householder matrix
-    initializeHouseholderMatrix();
+    initializeStereoVectors();
     
     // Initialize decay times (will be updated in prepare)
     initializeDecayTimes(baseRT60);
 }
 
-void HallEngine::prepare(const juce::dsp::ProcessSpec& spec)
+size_t HallEngine::getDelayMemorySize(const juce::dsp::ProcessSpec& spec)
 {
-    sampleRate = spec.sampleRate;
-    
-    // Calculate max delay needed (longest delay * max timeScale * 2)
-    int maxDelaySamples = static_cast<int>(spec.sampleRate * 0.6);  // 600ms max
-    int bufferSize = maxDelaySamples * 2;
-    
-    // Large delays for hall character (100-500ms)
+    DelayArena::Region counter;
+    layoutDelays(spec.sampleRate, counter);
+    return counter.getUsed();
+}
+
+void HallEngine::layoutDelays(double rate, DelayArena::Region& memory)
+{
+    // Large delays for hall character (100-950ms)
     std::array<int, numLines> delayMs = {
         113, 173, 229, 283, 337, 397, 449, 503,
         563, 613, 673, 727, 787, 839, 887, 947
     };
     
-    for (size_t i = 0; i < delays.size(); ++i) {
-        baseDelaySamples[i] = static_cast<int>(delayMs[i] * spec.sampleRate / 1000.0);
-        delays[i].prepare(baseDelaySamples[i], bufferSize);
+    // Each line sized for the longest delay it can be asked for
+    std::array<int, numLines> maxDelays {};
+    for (int i = 0; i < numLines; ++i) {
+        baseDelaySamples[i] = static_cast<int>(delayMs[i] * rate / 1000.0);
+        maxDelays[i] = EngineLimits::getMaxDelaySamples(baseDelaySamples[i]);
     }
+    core.prepare(numLines, maxDelays.data(), memory);
+}
+
+void HallEngine::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    sampleRate = spec.sampleRate;
     
-    // Prepare damping filters
-    for (size_t i = 0; i < dampingFilters.size(); ++i) {
-        dampingFilters[i].prepare(spec);
-        // Higher delay lines get more damping (simulate HF loss)
-        float cutoff = 3000.0f + (i / static_cast<float>(numLines)) * 5000.0f;
-        dampingCoeffs[i] = juce::dsp::IIR::Coefficients<float>::makeLowPass(
-            spec.sampleRate, cutoff, 0.5f);  // Soft Q
-        *dampingFilters[i].state = *dampingCoeffs[i];
+    auto memory = ownDelayMemory.assignedOrOwn(delayMemory, getDelayMemorySize(spec));
+    layoutDelays(spec.sampleRate, memory);
+    for (int i = 0; i < numLines; ++i) {
+        core.setBaseDelay(i, static_cast<float>(baseDelaySamples[i]));
+        core.setInputGains(i, inputGains[0][i], inputGains[1][i]);
+        core.setOutputTaps(i, outputTaps[0][i], outputTaps[1][i]);
     }
     
+    const auto blockSize = static_cast<size_t>(spec.maximumBlockSize);
+    delayScale.assign(blockSize, 1.0f);
+    wetLeft.assign(blockSize, 0.0f);
+    wetRight.assign(blockSize, 0.0f);
+    
     // Initialize decay times
     initializeDecayTimes(baseRT60);
     
@@ -54,29 +65,21 @@ void HallEngine::prepare(const juce::dsp::ProcessSpec& spec)
 
 void HallEngine::reset()
 {
-    for (auto& delay : delays) {
-        std::fill(delay.buffer.begin(), delay.buffer.end(), 0.0f);
-        delay.writePos = 0;
-    }
-    
-    modPhase = 0.0f;
+    core.reset();
 }
 
-void HallEngine::initializeHouseholderMatrix()
+void HallEngine::initializeStereoVectors()
 {
-    // Householder matrix for 16x16: H[i][j] = (i==j ? 1-2/N : -2/N)
-    const float N = static_cast<float>(numLines);
-    const float scale = 2.0f / N;
-    
-    for (int i = 0; i < numLines; ++i) {
-        for (int j = 0; j < numLines; ++j) {
-            if (i == j) {
-                mixingMatrix[i][j] = 1.0f - scale;
-            } else {
-                mixingMatrix[i][j] = -scale;
-            }
-        }
-    }
+    // Walsh-Hadamard rows: entry (row, i) is -1 when row & i has odd parity. Row 0
+    // (all ones) is skipped: it is the Householder matrix's -1 eigenvector.
+    auto hadamardRow = [](int row) {
+        std::array<float, numLines> v;
+        for (int i = 0; i < numLines; ++i)
+            v[static_cast<size_t>(i)] = (juce::countNumberOfBits(static_cast<juce::uint32>(row & i)) & 1) ? -1.0f : 1.0f;
+        return v;
+    };
+    inputGains = { hadamardRow(1), hadamardRow(2) };
+    outputTaps = { hadamardRow(numLines - 1), hadamardRow(numLines / 2 - 1) };
 }
 
 void HallEngine::initializeDecayTimes(float baseRT60)
@@ -94,8 +97,6 @@ void HallEngine::initializeDecayTimes(float baseRT60)
         float samplesPerRT60 = rt60 * sampleRate;
         decayGains[i] = std::pow(10.0f, -60.0f / (20.0f * samplesPerRT60));
         decayGains[i] = juce::jlimit(0.5f, 0.99f, decayGains[i]);
-        
-        delays[i].decayGain = decayGains[i];
     }
 }
 
@@ -111,14 +112,31 @@ void HallEngine::updateParameters()
     
     // Update damping based on diffusion (higher diffusion = more damping)
     float dampingAmount = params.diffusion / 100.0f;
-    for (size_t i = 0; i < dampingFilters.size(); ++i) {
+    for (size_t i = 0; i < dampingCoeffs.size(); ++i) {
         float baseCutoff = 3000.0f + (i / static_cast<float>(numLines)) * 5000.0f;
         float cutoff = baseCutoff * (1.0f - dampingAmount * 0.4f);  // Reduce with more diffusion
         cutoff = juce::jlimit(500.0f, 20000.0f, cutoff);
         
-        dampingCoeffs[i] = juce::dsp::IIR::Coefficients<float>::makeLowPass(
-            sampleRate, cutoff, 0.5f);  // Soft Q
-        *dampingFilters[i].state = *dampingCoeffs[i];
+        dampingCoeffs[i] = juce::dsp::IIR::ArrayCoefficients<float>::makeLowPass(sampleRate, cutoff, 0.5f);  // Soft Q
+    }
+    
+    // Delay modulation: each line follows the shared LFO at its own phase (three
+    // quarters of the depth) and all of them wander with its smooth random (the rest)
+    modAmount = params.modDepth > 0.01f ? params.modDepth * 0.0001f : 0.0f;
+    core.setModulationDepth(0.75f * modAmount);
+    
+    updateCore();
+}
+
+void HallEngine::updateCore()
+{
+    if (core.getNumLines() != numLines) return;  // Not prepared yet
+    
+    // Filtered reads decay per line; the fed-back mix also carries the feedback gain
+    for (int i = 0; i < numLines; ++i) {
+        const auto& c = dampingCoeffs[static_cast<size_t>(i)];
+        core.setDamping(i, c[0] / c[3], c[1] / c[3], c[2] / c[3], c[4] / c[3], c[5] / c[3]);
+        core.setGains(i, decayGains[static_cast<size_t>(i)], feedbackGain * decayGains[static_cast<size_t>(i)]);
     }
 }
 
@@ -126,70 +144,64 @@ void HallEngine::process(juce::AudioBuffer<float>& buffer)
 {
     const int numSamples = buffer.getNumSamples();
     const int numChannels = buffer.getNumChannels();
+    float* left = buffer.getWritePointer(0);
+    float* right = numChannels > 1 ? buffer.getWritePointer(1) : nullptr;
     
-    // Calculate modulation
-    const float modIncrement = 2.0f * juce::MathConstants<float>::pi * params.modRateHz / static_cast<float>(sampleRate);
-    float modAmount = params.modDepth * 0.0001f;
+    // Mix dry/wet (hall character: mostly wet, long tail)
+    const float dryGain = 0.05f;
+    const float wetGain = 0.95f;
     
-    for (int sample = 0; sample < numSamples; ++sample) {
-        // Calculate modulation for delay lengths
-        float mod = 1.0f;
-        if (params.modDepth > 0.01f) {
-            mod = 1.0f + std::sin(modPhase) * modAmount;
-            modPhase += modIncrement;
-            if (modPhase > 2.0f * juce::MathConstants<float>::pi) {
-                modPhase -= 2.0f * juce::MathConstants<float>::pi;
-            }
+    // One network step per stereo frame, in blocks of the scratch size
+    const int maxBlock = static_cast<int>(delayScale.size());
+    if (maxBlock == 0) return;  // Not prepared yet
+    const bool modulated = lfo != nullptr && lfo->getNumSamples() >= numSamples;
+    for (int start = 0; start < numSamples; start += maxBlock) {
+        const int blockSize = juce::jmin(maxBlock, numSamples - start);
+        
+        // Delay lengths scale with time and wander together; the core adds each
+        // line's own modulation
+        if (modulated) {
+            const float* wander = lfo->getRandom() + start;
+            const float wanderAmount = 0.25f * modAmount;
+            for (int sample = 0; sample < blockSize; ++sample)
+                delayScale[static_cast<size_t>(sample)] = params.timeScale * (1.0f + wanderAmount * wander[sample]);
+        } else {
+            std::fill(delayScale.begin(), delayScale.begin() + blockSize, params.timeScale);
         }
         
-        // Process each channel
-        for (int ch = 0; ch < numChannels; ++ch) {
-            float* channelData = buffer.getWritePointer(ch);
-            float input = channelData[sample];
-            
-            // Calculate scaled delay lengths
-            std::array<float, numLines> delayed;
-            for (size_t i = 0; i < delays.size(); ++i) {
-                int delaySamples = static_cast<int>(baseDelaySamples[i] * params.timeScale * mod);
-                delaySamples = juce::jlimit(1, static_cast<int>(delays[i].buffer.size()) - 1, delaySamples);
-                delayed[i] = delays[i].read(delaySamples);
-            }
-            
-            // Apply damping filters (soft HF damping)
-            for (size_t i = 0; i < dampingFilters.size(); ++i) {
-                delayed[i] = dampingFilters[i].processSample(delayed[i]);
-            }
-            
-            // Apply LF-weighted decay
-            for (size_t i = 0; i < delays.size(); ++i) {
-                delayed[i] *= delays[i].decayGain;
-            }
-            
-            // Mix through Householder matrix
-            std::array<float, numLines> mixed;
-            for (int i = 0; i < numLines; ++i) {
-                mixed[i] = 0.0f;
-                for (int j = 0; j < numLines; ++j) {
-                    mixed[i] += mixingMatrix[i][j] * delayed[j];
-                }
-            }
-            
-            // Calculate output (sum of mixed signals)
-            float output = 0.0f;
-            for (int i = 0; i < numLines; ++i) {
-                output += mixed[i];
-            }
-            
-            // Write feedback with per-line decay
-            for (size_t i = 0; i < delays.size(); ++i) {
-                delays[i].write(input + mixed[i] * feedbackGain * delays[i].decayGain);
+        float* inL = left + start;
+        float* inR = right != nullptr ? right + start : inL;
+        core.process(inL, inR, wetLeft.data(), wetRight.data(), delayScale.data(),
+                     modulated ? lfo->getSine() + start : nullptr, modulated ? lfo->getCosine() + start : nullptr, blockSize);
+        
+        for (int sample = 0; sample < blockSize; ++sample) {
+            const size_t i = static_cast<size_t>(sample);
+            if (right != nullptr) {
+                inL[sample] = inL[sample] * dryGain + wetLeft[i] * wetGain;
+                inR[sample] = inR[sample] * dryGain + wetRight[i] * wetGain;
+            } else {
+                inL[sample] = inL[sample] * dryGain + 0.5f * (wetLeft[i] + wetRight[i]) * wetGain;
             }
-            
-            // Mix dry/wet (hall character: mostly wet, long tail)
-            const float dryGain = 0.05f;
-            const float wetGain = 0.95f;
-            
-            channelData[sample] = input * dryGain + output * wetGain;
         }
     }
 }
+
+double HallEngine::getMemorySeconds() const
+{
+    // The longest line at the current time scale and full modulation
+    const int longest = *std::max_element(baseDelaySamples.begin(), baseDelaySamples.end());
+    return longest * params.timeScale * (1.0f + EngineLimits::maxModulation) / sampleRate;
+}
+
+double HallEngine::getDecaySeconds() const
+{
+    // Each pass goes through the read and the loop gain; the Householder mix spreads
+    // energy over every line, so a pass is the mean line at the mean (log) gain
+    double delaySum = 0.0, logGainSum = 0.0;
+    for (int i = 0; i < numLines; ++i) {
+        const size_t line = static_cast<size_t>(i);
+        delaySum += baseDelaySamples[line];
+        logGainSum += std::log(static_cast<double>(decayGains[line]) * decayGains[line] * feedbackGain);
+    }
+    return getLoopDecaySeconds(delaySum / numLines * params.timeScale / sampleRate, std::exp(logGainSum / numLines));
+}
@@ -5,30 +5,309 @@
 #include "RoomEngine.h"
 #include "HallEngine.h"
 
-void HybridVerb::prepare(const juce::dsp::ProcessSpec& spec)
+HybridVerb::HybridVerb()
+: juce::Thread("AmbiGlass Engine Builder"),
+  ir(new IRConvolutionEngine())
 {
-    ir.reset(new IRConvolutionEngine());
-    spring.reset(new SpringEngine());
-    plate.reset(new PlateEngine());
-    room.reset(new RoomEngine());
-    hall.reset(new HallEngine());
+}
+
+HybridVerb::~HybridVerb()
+{
+    stopThread(2000);
+    for (int slot = 0; slot < numAlgorithmicModes; ++slot) {
+        freeEngine(pending[static_cast<size_t>(slot)].exchange(nullptr));
+        freeEngine(retired[static_cast<size_t>(slot)].exchange(nullptr));
+        freeEngine(active[static_cast<size_t>(slot)].release());
+    }
+}
 
+void HybridVerb::prepare(const juce::dsp::ProcessSpec& newSpec)
+{
+    // The audio thread is stopped here; so is the engine thread from now on, so
+    // every engine can be dropped and rebuilt for the new spec directly
+    stopThread(2000);
+    for (int slot = 0; slot < numAlgorithmicModes; ++slot) {
+        freeEngine(pending[static_cast<size_t>(slot)].exchange(nullptr));
+        freeEngine(retired[static_cast<size_t>(slot)].exchange(nullptr));
+        freeEngine(active[static_cast<size_t>(slot)].release());
+        idleSamples[static_cast<size_t>(slot)] = 0;
+    }
+    builtSlots = 0;
+    spec = newSpec;
+    
+    const int numChannels = juce::jmax(2, static_cast<int>(spec.numChannels));
+    transitionInput.setSize(numChannels, static_cast<int>(spec.maximumBlockSize));
+    transitionWork.setSize(numChannels, static_cast<int>(spec.maximumBlockSize));
+    fadeGains.assign(spec.maximumBlockSize, 0.0f);
+    lfo.prepare(spec.sampleRate, static_cast<int>(spec.maximumBlockSize));
+    
+    // The IR engine lives as long as this object: prepare() rebuilds its IR for the new
+    // spec, at the stretch from the params
+    appliedParams = {};
+    applyParams(static_cast<int>(ReverbMode::IR), *ir);
     ir->prepare(spec);
-    spring->prepare(spec);
-    plate->prepare(spec);
-    room->prepare(spec);
-    hall->prepare(spec);
+    
+    // The current mode is ready straight away, without a fade in; others follow when selected.
+    // Its params are applied here, so the tail reported before the first block is its own.
+    const auto current = mode.load();
+    if (current != ReverbMode::IR) {
+        const int slot = getSlot(current);
+        active[static_cast<size_t>(slot)].reset(buildEngine(slot));
+        builtSlots |= 1u << slot;
+        applyParams(static_cast<int>(current), *active[static_cast<size_t>(slot)]->engine);
+    }
+    playingMode = current;
+    updateTailSeconds(getEngine(static_cast<int>(current)));
+    quietSamples = 0;
+    tailSilent = false;
+    voices = {};
+    voices[static_cast<size_t>(current)] = { 1.0f, true };
+    
+    // Keep what was preloaded before prepare()
+    requestedSlots &= ~builtSlots.load();
+    startThread(juce::Thread::Priority::low);
 }
 
-void HybridVerb::process(juce::AudioBuffer<float>& buffer)
+void HybridVerb::preloadMode(ReverbMode m)
+{
+    if (m != ReverbMode::IR)
+        requestedSlots.fetch_or(1u << getSlot(m));
+}
+
+HybridVerb::BuiltEngine* HybridVerb::buildEngine(int slot)
 {
-    switch (mode)
+    auto built = std::make_unique<BuiltEngine>();
+    switch (static_cast<ReverbMode>(slot + static_cast<int>(ReverbMode::Spring)))
     {
-        case ReverbMode::IR:      ir->setParams(params);      ir->process(buffer); break;
-        case ReverbMode::Spring:  spring->setParams(params);  spring->process(buffer); break;
-        case ReverbMode::Plate:   plate->setParams(params);   plate->process(buffer); break;
-        case ReverbMode::Room:    room->setParams(params);    room->process(buffer); break;
-        case ReverbMode::Hall:    hall->setParams(params);    hall->process(buffer); break;
+        case ReverbMode::Spring:  built->engine.reset(new SpringEngine()); break;
+        case ReverbMode::Plate:   built->engine.reset(new PlateEngine()); break;
+        case ReverbMode::Room:    built->engine.reset(new RoomEngine()); break;
+        case ReverbMode::Hall:    built->engine.reset(new HallEngine()); break;
+        case ReverbMode::IR:      jassertfalse; return nullptr;
+    }
+    
+    // All of the engine's delay lines in one allocation
+    const size_t size = DelayArena::roundUp(built->engine->getDelayMemorySize(spec));
+    built->delays.allocate(size);
+    built->engine->setDelayMemory(built->delays.getRegion(0, size));
+    built->engine->setModulation(&lfo);
+    built->engine->prepare(spec);
+    
+    delayMemoryBytes += built->delays.getBytes();
+    return built.release();
+}
+
+void HybridVerb::freeEngine(BuiltEngine* built)
+{
+    if (built == nullptr) return;
+    delayMemoryBytes -= built->delays.getBytes();
+    delete built;
+}
+
+void HybridVerb::run()
+{
+    while (!threadShouldExit()) {
+        for (int slot = 0; slot < numAlgorithmicModes; ++slot)
+            freeEngine(retired[static_cast<size_t>(slot)].exchange(nullptr, std::memory_order_acquire));
+        
+        const auto requested = requestedSlots.exchange(0);
+        for (int slot = 0; slot < numAlgorithmicModes; ++slot) {
+            const auto bit = 1u << slot;
+            if ((requested & bit) == 0 || (builtSlots.load() & bit) != 0)
+                continue;
+            // The audio thread takes it over on its next block
+            pending[static_cast<size_t>(slot)].store(buildEngine(slot), std::memory_order_release);
+            builtSlots |= bit;
+        }
+        
+        wait(20);
+    }
+}
+
+void HybridVerb::updateEngines(int numSamples)
+{
+    const auto requested = mode.load();
+    const auto idleLimit = static_cast<juce::int64>(idleReleaseSeconds * spec.sampleRate);
+    
+    for (int slot = 0; slot < numAlgorithmicModes; ++slot) {
+        const auto i = static_cast<size_t>(slot);
+        const int modeIndex = slot + static_cast<int>(ReverbMode::Spring);
+        if (active[i] == nullptr) {
+            active[i].reset(pending[i].exchange(nullptr, std::memory_order_acquire));
+            appliedParams[static_cast<size_t>(modeIndex)] = 0;
+        }
+        
+        if (requested != ReverbMode::IR && slot == getSlot(requested)) {
+            idleSamples[i] = 0;
+            if (active[i] == nullptr)
+                requestedSlots.fetch_or(1u << slot);  // First use: built on the engine thread
+            continue;
+        }
+        
+        // Fading or ringing engines are in use
+        if (voices[static_cast<size_t>(modeIndex)].isActive()) {
+            idleSamples[i] = 0;
+            continue;
+        }
+        
+        // Idle engines go back to the engine thread to be freed (once its slot is empty)
+        if (active[i] != nullptr && (idleSamples[i] += numSamples) > idleLimit
+            && retired[i].load(std::memory_order_relaxed) == nullptr) {
+            retired[i].store(active[i].release(), std::memory_order_release);
+            builtSlots &= ~(1u << slot);
+            idleSamples[i] = 0;
+        }
+    }
+}
+
+void HybridVerb::applyParams(int modeIndex, IReverbEngine& engine)
+{
+    auto& applied = appliedParams[static_cast<size_t>(modeIndex)];
+    if (applied != paramsVersion) {
+        engine.setParams(params);
+        applied = paramsVersion;
+    }
+}
+
+IReverbEngine* HybridVerb::getEngine(int modeIndex) const
+{
+    if (modeIndex == static_cast<int>(ReverbMode::IR))
+        return ir.get();
+    const auto& built = active[static_cast<size_t>(getSlot(static_cast<ReverbMode>(modeIndex)))];
+    return built != nullptr ? built->engine.get() : nullptr;
+}
+
+float HybridVerb::getPeak(const juce::AudioBuffer<float>& buffer)
+{
+    float peak = 0.0f;
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        peak = juce::jmax(peak, buffer.getMagnitude(ch, 0, buffer.getNumSamples()));
+    return peak;
+}
+
+void HybridVerb::process(juce::AudioBuffer<float>& buffer)
+{
+    const int numSamples = buffer.getNumSamples();
+    const float inputPeak = getPeak(buffer);
+    lfo.setRate(params.modRateHz);
+    lfo.process(numSamples);
+    const bool single = processEngines(buffer);
+    
+    // Tail detection: the engine's state is only reachable through its output, so
+    // silence in and out for as long as the engine remembers means it is empty
+    if (inputPeak <= silenceThreshold && getPeak(buffer) <= silenceThreshold)
+        quietSamples += numSamples;
+    else
+        quietSamples = 0;
+    
+    const auto* engine = getEngine(static_cast<int>(playingMode.load()));
+    tailSilent = single && engine != nullptr
+              && quietSamples >= static_cast<juce::int64>(engine->getMemorySeconds() * spec.sampleRate) + numSamples;
+    updateTailSeconds(engine);
+}
+
+void HybridVerb::updateTailSeconds(const IReverbEngine* engine)
+{
+    if (engine != nullptr)
+        tailSeconds.store(engine->getDecaySeconds() + getLatencySamples() / spec.sampleRate, std::memory_order_relaxed);
+}
+
+bool HybridVerb::processEngines(juce::AudioBuffer<float>& buffer)
+{
+    updateEngines(buffer.getNumSamples());
+    
+    // Switch once the selected engine is ready; until then the previous one plays on
+    const auto requested = mode.load();
+    if (requested != playingMode.load() && getEngine(static_cast<int>(requested)) != nullptr)
+        playingMode = requested;
+    
+    const int playing = static_cast<int>(playingMode.load());
+    IReverbEngine* engine = getEngine(playing);
+    bool transition = false;
+    for (int m = 0; m < numModes; ++m)
+        if (m != playing && voices[static_cast<size_t>(m)].isActive() && getEngine(m) != nullptr)
+            transition = true;
+    
+    if (engine == nullptr) {
+        buffer.clear();
+        return true;
+    }
+    
+    // Steady state: one engine, in place
+    if (!transition && voices[static_cast<size_t>(playing)].fade == 1.0f) {
+        applyParams(playing, *engine);
+        engine->process(buffer);
+        return true;
+    }
+    processTransition(buffer);
+    return false;
+}
+
+void HybridVerb::processTransition(juce::AudioBuffer<float>& buffer)
+{
+    // Host blocks never exceed the prepared size; if one does, finish the handoff at once
+    const int numSamples = buffer.getNumSamples();
+    const int numChannels = juce::jmin(buffer.getNumChannels(), transitionInput.getNumChannels());
+    const int playing = static_cast<int>(playingMode.load());
+    if (numSamples > transitionInput.getNumSamples()) {
+        for (int m = 0; m < numModes; ++m)
+            voices[static_cast<size_t>(m)] = m == playing ? Voice { 1.0f, true } : Voice {};
+        applyParams(playing, *getEngine(playing));
+        getEngine(playing)->process(buffer);
+        return;
+    }
+    
+    for (int ch = 0; ch < numChannels; ++ch)
+        transitionInput.copyFrom(ch, 0, buffer, ch, 0, numSamples);
+    buffer.clear();
+    
+    const float step = 1.0f / juce::jmax(1.0f, crossfadeSeconds.load() * static_cast<float>(spec.sampleRate));
+    for (int m = 0; m < numModes; ++m) {
+        auto& voice = voices[static_cast<size_t>(m)];
+        IReverbEngine* engine = getEngine(m);
+        if (engine == nullptr) {
+            voice = {};
+            continue;
+        }
+        if (m != playing && !voice.isActive())
+            continue;
+        
+        // Equal-power input gains: sin on the way in, cos on the way out
+        const float direction = m == playing ? step : -step;
+        float fade = voice.fade;
+        for (int i = 0; i < numSamples; ++i) {
+            fade = juce::jlimit(0.0f, 1.0f, fade + direction);
+            fadeGains[static_cast<size_t>(i)] = std::sin(fade * juce::MathConstants<float>::halfPi);
+        }
+        voice.fade = fade;
+        
+        for (int ch = 0; ch < numChannels; ++ch) {
+            const float* in = transitionInput.getReadPointer(ch);
+            float* work = transitionWork.getWritePointer(ch);
+            for (int i = 0; i < numSamples; ++i)
+                work[i] = in[i] * fadeGains[static_cast<size_t>(i)];
+        }
+        
+        // A view of the scratch, so nothing is allocated
+        juce::AudioBuffer<float> view(transitionWork.getArrayOfWritePointers(), numChannels, numSamples);
+        applyParams(m, *engine);
+        engine->process(view);
+        
+        float peak = 0.0f;
+        for (int ch = 0; ch < numChannels; ++ch) {
+            buffer.addFrom(ch, 0, view, ch, 0, numSamples);
+            peak = juce::jmax(peak, view.getMagnitude(ch, 0, numSamples));
+        }
+        
+        // The outgoing engine stops once its input is gone and its tail has stayed
+        // inaudible for tailHoldSeconds (so a predelay does not count as the end)
+        if (m == playing || fade > 0.0f || peak > tailThreshold) {
+            voice.ringing = true;
+            voice.quietSamples = 0;
+        } else {
+            voice.quietSamples += numSamples;
+            voice.ringing = voice.quietSamples < static_cast<int>(tailHoldSeconds * spec.sampleRate);
+        }
     }
 }
 
@@ -40,6 +319,47 @@ bool HybridVerb::loadIR(const juce::File& file)
     return false;
 }
 
+bool HybridVerb::loadIRNow(const juce::File& file)
+{
+    if (auto* convo = dynamic_cast<IRConvolutionEngine*>(ir.get())) {
+        // The build takes the stretch from the params
+        applyParams(static_cast<int>(ReverbMode::IR), *convo);
+        const bool loaded = convo->loadIRNow(file);
+        updateTailSeconds(getEngine(static_cast<int>(playingMode.load())));
+        return loaded;
+    }
+    return false;
+}
+
+void HybridVerb::setIRLowLatency(bool enabled)
+{
+    if (auto* convo = dynamic_cast<IRConvolutionEngine*>(ir.get())) {
+        convo->setLowLatency(enabled);
+    }
+}
+
+void HybridVerb::setIRBackgroundTail(bool enabled)
+{
+    if (auto* convo = dynamic_cast<IRConvolutionEngine*>(ir.get())) {
+        convo->setBackgroundTail(enabled);
+    }
+}
+
+void HybridVerb::setIRHybridTail(bool enabled)
+{
+    if (auto* convo = dynamic_cast<IRConvolutionEngine*>(ir.get())) {
+        convo->setHybridTail(enabled);
+    }
+}
+
+juce::String HybridVerb::getIRInfo() const
+{
+    if (auto* convo = dynamic_cast<const IRConvolutionEngine*>(ir.get())) {
+        return convo->getIRInfo();
+    }
+    return {};
+}
+
 int HybridVerb::getIRLatency() const
 {
     if (auto* convo = dynamic_cast<const IRConvolutionEngine*>(ir.get())) {
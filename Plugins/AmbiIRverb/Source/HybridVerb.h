@@ -1,5 +1,7 @@
 #pragma once
 #include <JuceHeader.h>
+#include "DelayArena.h"
+#include "LfoBank.h"
 
 enum class ReverbMode { IR, Spring, Plate, Room, Hall };
 
@@ -8,35 +10,192 @@ struct EngineParams
     float timeScale { 1.0f };
     float width { 1.0f };
     float depth { 0.5f };
+    float diffusion { 35.0f };  // Percent
     float modDepth { 0.1f };
     float modRateHz { 0.3f };
     juce::NamedValueSet advanced;
 };
 
+// Range the algorithmic engines size their delay memory for: Time (rtScale) up
+// to 2x and delay modulation of up to 1% (modDepth 100% x 0.0001)
+namespace EngineLimits
+{
+    constexpr float maxTimeScale = 2.0f;
+    constexpr float maxModulation = 0.01f;
+
+    // Taps an interpolated read looks past its delay (third-order Lagrange: up to 2)
+    constexpr int interpolationHeadroom = 3;
+
+    // Longest delay a line with this base delay can be asked for, in samples,
+    // plus room for the interpolator's taps
+    inline int getMaxDelaySamples(int baseDelaySamples)
+    {
+        return static_cast<int>(std::ceil(static_cast<float>(baseDelaySamples) * maxTimeScale * (1.0f + maxModulation)))
+             + 1 + interpolationHeadroom;
+    }
+}
+
 struct IReverbEngine {
     virtual ~IReverbEngine() = default;
+    // Floats of delay memory prepare() takes at this spec (none for engines without delay lines)
+    virtual size_t getDelayMemorySize(const juce::dsp::ProcessSpec&) { return 0; }
+    // Arena region prepare() places the delay lines in; set before each prepare()
+    virtual void setDelayMemory(DelayArena::Region) {}
+    // Modulation source shared by all engines, filled for each block before
+    // process() (its getNumSamples() matches the block); set before prepare()
+    virtual void setModulation(const LfoBank*) {}
     virtual void prepare(const juce::dsp::ProcessSpec&) = 0;
     virtual void reset() = 0;
     virtual void setParams(const EngineParams&) = 0;
     virtual void process(juce::AudioBuffer<float>&) = 0;
+    // Longest an input sample can stay inside the engine before it reaches the output
+    // (at the current settings). Once input and output have both been silent this
+    // long, the tail is gone.
+    virtual double getMemorySeconds() const = 0;
+    // Time the output takes to fall 60 dB once the input stops, at the current
+    // settings: how much a bounce has to render after the last sample
+    virtual double getDecaySeconds() const = 0;
+
+protected:
+    // RT60 of a recirculating loop of loopSeconds that is scaled by loopGain per pass.
+    // For a network whose mixing matrix spreads energy evenly over its lines, pass
+    // the mean line length and the geometric mean of the line gains.
+    static double getLoopDecaySeconds(double loopSeconds, double loopGain)
+    {
+        if (loopGain <= 0.0)
+            return loopSeconds;
+        return -3.0 * loopSeconds / std::log10(juce::jmin(loopGain, 0.9999));
+    }
 };
 
 class IRConvolutionEngine; class SpringEngine; class PlateEngine; class RoomEngine; class HallEngine;
 
-class HybridVerb
+// Runs the engine of the selected mode. The IR engine always exists (it owns the
+// loaded IR); the algorithmic engines are built the first time their mode is
+// selected or preloaded, on the engine thread, and handed to the audio thread.
+// An engine whose mode has not run for idleReleaseSeconds is freed again.
+//
+// Mode switches hand over instead of jumping: the input to the old engine fades
+// out while the input to the new one fades in (equal power, over the crossfade
+// time), and the old engine keeps ringing on silence until its output has stayed
+// below tailThreshold for tailHoldSeconds. Outside a switch only one engine runs,
+// in place.
+class HybridVerb : private juce::Thread
 {
 public:
+    HybridVerb();
+    ~HybridVerb() override;
+    
+    // Builds the IR engine and the current mode's engine. Not real-time safe.
     void prepare(const juce::dsp::ProcessSpec&);
     void setMode(ReverbMode m) { mode = m; }
-    void setParams(const EngineParams& p) { params = p; }
+    // Builds this mode's engine ahead of a switch. Any thread; never blocks.
+    void preloadMode(ReverbMode m);
+    // Engines take the new values on their next block; unchanged parameters cost nothing
+    void setParams(const EngineParams& p) { params = p; ++paramsVersion; }
+    void setCrossfadeSeconds(float seconds) { crossfadeSeconds = juce::jmax(0.001f, seconds); }
+    // The previous mode keeps playing until the selected engine is built
     void process(juce::AudioBuffer<float>&);
+    // True once input and output have been silent for the playing engine's memory
+    // (and no other engine fades or rings): process() would only produce silence
+    // until the input returns. Audio thread.
+    bool isTailSilent() const { return tailSilent; }
+    
+    // Peak below which a block counts as silent (-90 dBFS)
+    static constexpr float silenceThreshold = 3.2e-5f;
+    static float getPeak(const juce::AudioBuffer<float>& buffer);
     
     // IR-specific methods
     bool loadIR(const juce::File& file);
+    // Offline rendering: loads and builds the IR before returning, at the current
+    // params; the audio thread must be stopped. After prepare().
+    bool loadIRNow(const juce::File& file);
+    void setIRLowLatency(bool enabled);
+    void setIRBackgroundTail(bool enabled);
+    void setIRHybridTail(bool enabled);
     int getIRLatency() const;
+    juce::String getIRInfo() const;
+    
+    // Latency of the playing mode; only IR adds any
+    int getLatencySamples() const { return playingMode == ReverbMode::IR ? getIRLatency() : 0; }
+    
+    // How long the playing mode keeps sounding after the input stops (its decay
+    // plus latency), as of the last block. Any thread.
+    double getTailSeconds() const { return tailSeconds.load(std::memory_order_relaxed); }
+    
+    // Modulation of the last block, at the engines' modRateHz; the processor's
+    // later stages (ModTail) read it after process(). Audio thread.
+    const LfoBank& getModulation() const { return lfo; }
+    
+    // Delay memory of the engines currently built (one arena each)
+    size_t getDelayMemoryBytes() const { return delayMemoryBytes.load(); }
 
 private:
-    ReverbMode mode { ReverbMode::IR };
-    std::unique_ptr<IReverbEngine> ir, spring, plate, room, hall;
+    // An algorithmic engine and the arena its delay lines live in
+    struct BuiltEngine
+    {
+        std::unique_ptr<IReverbEngine> engine;
+        DelayArena delays;
+    };
+    
+    static constexpr int numModes = 5;
+    static constexpr int numAlgorithmicModes = 4;  // Spring, Plate, Room, Hall
+    static constexpr double idleReleaseSeconds = 30.0;
+    static constexpr float tailThreshold = silenceThreshold;
+    static constexpr double tailHoldSeconds = 0.2;
+    static int getSlot(ReverbMode m) { return static_cast<int>(m) - static_cast<int>(ReverbMode::Spring); }
+    
+    // Not real-time safe; the caller owns the result
+    BuiltEngine* buildEngine(int slot);
+    void freeEngine(BuiltEngine* built);
+    // Engine thread: builds requested engines and frees released ones
+    void run() override;
+    // Audio thread: takes built engines, releases idle ones
+    void updateEngines(int numSamples);
+    // Audio thread: the engine for this mode if it is built
+    IReverbEngine* getEngine(int modeIndex) const;
+    // Audio thread: runs the playing engine, or all fading and ringing ones;
+    // returns false if several ran
+    bool processEngines(juce::AudioBuffer<float>& buffer);
+    void processTransition(juce::AudioBuffer<float>& buffer);
+    void updateTailSeconds(const IReverbEngine* engine);
+    // Hands params to this mode's engine if it has not seen them yet
+    void applyParams(int modeIndex, IReverbEngine& engine);
+    
+    // Per mode: how far its input is faded in (0..1), and whether its tail still rings
+    struct Voice
+    {
+        float fade = 0.0f;
+        bool ringing = false;
+        int quietSamples = 0;
+        bool isActive() const { return fade > 0.0f || ringing; }
+    };
+    
+    std::atomic<ReverbMode> mode { ReverbMode::IR };
+    std::atomic<ReverbMode> playingMode { ReverbMode::IR };
+    std::atomic<float> crossfadeSeconds { 0.05f };
     EngineParams params;
+    juce::uint32 paramsVersion = 1;
+    juce::dsp::ProcessSpec spec {};
+    std::unique_ptr<IReverbEngine> ir;
+    LfoBank lfo;   // Filled once per block, read by every engine
+    
+    // Single-slot handoffs per mode, as in IRConvolutionEngine: the engine thread
+    // publishes to `pending`, the audio thread gives engines back through `retired`
+    std::atomic<juce::uint32> requestedSlots { 0 };
+    std::atomic<juce::uint32> builtSlots { 0 };
+    std::array<std::atomic<BuiltEngine*>, numAlgorithmicModes> pending {};
+    std::array<std::atomic<BuiltEngine*>, numAlgorithmicModes> retired {};
+    std::atomic<size_t> delayMemoryBytes { 0 };
+    std::atomic<double> tailSeconds { 0.0 };
+    
+    // Audio thread only
+    std::array<std::unique_ptr<BuiltEngine>, numAlgorithmicModes> active;
+    std::array<juce::int64, numAlgorithmicModes> idleSamples {};
+    std::array<Voice, numModes> voices {};
+    std::array<juce::uint32, numModes> appliedParams {};   // paramsVersion each engine has
+    juce::int64 quietSamples = 0;   // Input and output silent for this long
+    bool tailSilent = false;
+    juce::AudioBuffer<float> transitionInput, transitionWork;
+    std::vector<float> fadeGains;
 };
@@ -0,0 +1,97 @@
+#include "IRSpectraCache.h"
+
+namespace {
+    // Bump when the IR preparation (trim, normalisation, resampling, tail analysis) changes
+    constexpr int preparationVersion = 5;
+    
+    juce::File getCacheFile(const juce::String& key)
+    {
+        return IRSpectraCache::getCacheFolder().getChildFile(key + ".agspec");
+    }
+    
+    // Oldest first until the folder fits; entries still mapped elsewhere stay readable
+    // on POSIX and simply fail to delete on Windows
+    void evictLeastRecentlyUsed(const juce::File& keep)
+    {
+        auto files = IRSpectraCache::getCacheFolder().findChildFiles(juce::File::findFiles, false, "*.agspec");
+        juce::int64 total = 0;
+        for (const auto& file : files)
+            total += file.getSize();
+        if (total <= IRSpectraCache::maxCacheBytes)
+            return;
+        
+        std::sort(files.begin(), files.end(), [](const juce::File& a, const juce::File& b) {
+            return a.getLastModificationTime() < b.getLastModificationTime();
+        });
+        for (const auto& file : files) {
+            if (total <= IRSpectraCache::maxCacheBytes)
+                break;
+            const auto size = file.getSize();
+            if (file != keep && file.deleteFile())
+                total -= size;
+        }
+    }
+}
+
+juce::String IRSpectraCache::hashFile(const juce::File& file)
+{
+    static juce::CriticalSection lock;
+    static std::map<juce::String, juce::String> knownHashes;
+    
+    const auto id = file.getFullPathName() + "|" + juce::String(file.getSize()) + "|"
+                  + juce::String(file.getLastModificationTime().toMilliseconds());
+    {
+        const juce::ScopedLock sl(lock);
+        const auto it = knownHashes.find(id);
+        if (it != knownHashes.end()) return it->second;
+    }
+    
+    const auto hash = juce::SHA256(file).toHexString();
+    const juce::ScopedLock sl(lock);
+    knownHashes[id] = hash;
+    return hash;
+}
+
+juce::String IRSpectraCache::makeKey(const juce::String& fileHash, double sampleRate, int maximumBlockSize,
+                                     bool lowLatency, bool backgroundTail, bool hybridTail, float timeScale)
+{
+    // Uniform layouts depend on the block size; the low-latency layout does not
+    const juce::String layout = lowLatency ? juce::String(backgroundTail ? "llbg" : "ll")
+                                           : "u" + juce::String(PartitionedConvolver::uniformPartitionSize(maximumBlockSize));
+    return fileHash + "_" + juce::String(juce::roundToInt(sampleRate)) + "_" + layout + (hybridTail ? "_h" : "")
+         + "_t" + juce::String(juce::roundToInt(timeScale * 1000.0f)) + "_v" + juce::String(preparationVersion);
+}
+
+std::shared_ptr<const PreparedSpectra> IRSpectraCache::load(const juce::String& key)
+{
+    const auto file = getCacheFile(key);
+    if (!file.existsAsFile()) return nullptr;
+    
+    auto spectra = std::make_shared<PreparedSpectra>();
+    spectra->mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    if (spectra->getData() == nullptr) return nullptr;
+    file.setLastModificationTime(juce::Time::getCurrentTime());  // Recently used
+    return spectra;
+}
+
+bool IRSpectraCache::store(const juce::String& key, const PreparedSpectra& spectra)
+{
+    const auto file = getCacheFile(key);
+    juce::TemporaryFile temp(file);
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (out.failedToOpen()) return false;
+        out.write(spectra.getData(), spectra.getSize());
+        out.flush();
+        if (out.getStatus().failed()) return false;
+    }
+    if (!temp.overwriteTargetFileWithTemporary())
+        return false;
+    evictLeastRecentlyUsed(file);
+    return true;
+}
+
+void IRSpectraCache::remove(const juce::String& key)
+{
+    getCacheFile(key).deleteFile();
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PartitionedConvolver.h"
+
+// Prepared IR in the PartitionedConvolver::writeSpectra() layout, either memory-mapped
+// from the cache or held in memory. Read-only once created.
+struct PreparedSpectra {
+    std::unique_ptr<juce::MemoryMappedFile> mapped;
+    juce::MemoryBlock memory;
+    
+    const void* getData() const { return mapped != nullptr ? mapped->getData() : memory.getData(); }
+    size_t getSize() const { return mapped != nullptr ? mapped->getSize() : memory.getSize(); }
+};
+
+// On-disk cache of prepared IR partitions, so reopening a session maps the spectra
+// instead of decoding, resampling and transforming every IR again.
+// Entries are content-addressed: the key is the SHA-256 of the IR file plus everything
+// that shapes the spectra (sample rate, partition layout, time scale). Files are
+// written once via a temporary file and never modified, so several instances can map
+// the same entry. The folder is kept under maxCacheBytes by deleting the entries
+// used least recently (a hit refreshes the file's modification time).
+class IRSpectraCache {
+public:
+    static juce::File getCacheFolder() {
+        auto dir = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+                    .getChildFile("AmbiGlass/IRCache");
+        dir.createDirectory();
+        return dir;
+    }
+    
+    // Reads the whole file the first time; remembered per path, size and modification time
+    static juce::String hashFile(const juce::File& file);
+    
+    static juce::String makeKey(const juce::String& fileHash, double sampleRate, int maximumBlockSize,
+                                bool lowLatency, bool backgroundTail, bool hybridTail, float timeScale);
+    
+    static constexpr juce::int64 maxCacheBytes = juce::int64(1) << 30;
+    
+    // Maps the entry for key, or nullptr on a miss
+    static std::shared_ptr<const PreparedSpectra> load(const juce::String& key);
+    // Writes the entry, then evicts the least recently used others beyond maxCacheBytes
+    static bool store(const juce::String& key, const PreparedSpectra& spectra);
+    static void remove(const juce::String& key);
+};
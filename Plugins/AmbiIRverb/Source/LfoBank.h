@@ -0,0 +1,121 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Modulation sources shared by the engines and ModTail, filled once per block so
+// no consumer evaluates a transcendental per sample:
+//  - a quadrature sine (sine, cosine) from a recursive rotation, renormalised once
+//    per block so it cannot drift in amplitude
+//  - smooth random: a new random target in [-1, 1] every half period, reached
+//    along a smoothstep (continuous in value and slope)
+// Any other phase of the sine is sine * cos(offset) + cosine * sin(offset); see
+// PhaseOffset. Both sources run at the same rate.
+// No JUCE dependency; nothing but prepare() allocates.
+class LfoBank
+{
+public:
+    // A fixed offset from the bank's sine, in turns
+    struct PhaseOffset
+    {
+        float sin = 0.0f, cos = 1.0f;
+
+        static PhaseOffset fromTurns(double turns)
+        {
+            const double angle = 2.0 * 3.14159265358979323846 * turns;
+            return { static_cast<float>(std::sin(angle)), static_cast<float>(std::cos(angle)) };
+        }
+        // sin(phase + offset) from sin(phase) and cos(phase)
+        float apply(float sine, float cosine) const { return sine * cos + cosine * sin; }
+    };
+
+    // Blocks of up to maxBlock samples. Not real-time safe.
+    void prepare(double newSampleRate, int maxBlock)
+    {
+        sampleRate = newSampleRate;
+        sine.assign(static_cast<size_t>(std::max(1, maxBlock)), 0.0f);
+        cosine.assign(sine.size(), 0.0f);
+        random.assign(sine.size(), 0.0f);
+        rateHz = -1.0f;
+        setRate(0.3f);
+        reset();
+    }
+
+    void reset()
+    {
+        sinState = 0.0f;
+        cosState = 1.0f;
+        randomSeed = 0x9e3779b9u;
+        randomFrom = 0.0f;
+        randomTo = nextRandom();
+        randomPosition = 0.0f;
+        numSamples = 0;
+    }
+
+    // Cheap when unchanged; otherwise two transcendentals
+    void setRate(float hz)
+    {
+        if (hz == rateHz) return;
+        rateHz = hz;
+        const double step = 2.0 * 3.14159265358979323846 * hz / sampleRate;
+        rotationCos = static_cast<float>(std::cos(step));
+        rotationSin = static_cast<float>(std::sin(step));
+        randomStep = static_cast<float>(2.0 * hz / sampleRate);
+    }
+
+    // Fills the next block; blocks longer than prepared are cut short (getNumSamples())
+    void process(int newNumSamples)
+    {
+        numSamples = std::clamp(newNumSamples, 0, static_cast<int>(sine.size()));
+
+        float s = sinState, c = cosState;
+        for (int i = 0; i < numSamples; ++i) {
+            sine[static_cast<size_t>(i)] = s;
+            cosine[static_cast<size_t>(i)] = c;
+            const float rotated = c * rotationCos - s * rotationSin;
+            s = s * rotationCos + c * rotationSin;
+            c = rotated;
+        }
+        // First-order 1 / sqrt(r) around r = 1
+        const float correction = 0.5f * (3.0f - (s * s + c * c));
+        sinState = s * correction;
+        cosState = c * correction;
+
+        for (int i = 0; i < numSamples; ++i) {
+            const float t = randomPosition;
+            random[static_cast<size_t>(i)] = randomFrom + (randomTo - randomFrom) * t * t * (3.0f - 2.0f * t);
+            randomPosition += randomStep;
+            if (randomPosition >= 1.0f) {
+                randomPosition -= std::floor(randomPosition);
+                randomFrom = randomTo;
+                randomTo = nextRandom();
+            }
+        }
+    }
+
+    // Samples of the last process() call
+    int getNumSamples() const { return numSamples; }
+    const float* getSine() const { return sine.data(); }
+    const float* getCosine() const { return cosine.data(); }
+    const float* getRandom() const { return random.data(); }
+
+private:
+    // xorshift32, mapped to [-1, 1]
+    float nextRandom()
+    {
+        randomSeed ^= randomSeed << 13;
+        randomSeed ^= randomSeed >> 17;
+        randomSeed ^= randomSeed << 5;
+        return static_cast<float>(randomSeed) * (2.0f / 4294967295.0f) - 1.0f;
+    }
+
+    double sampleRate = 48000.0;
+    float rateHz = -1.0f;
+    float rotationCos = 1.0f, rotationSin = 0.0f;
+    float sinState = 0.0f, cosState = 1.0f;
+    float randomFrom = 0.0f, randomTo = 0.0f, randomPosition = 0.0f, randomStep = 0.0f;
+    std::uint32_t randomSeed = 0x9e3779b9u;
+    std::vector<float> sine, cosine, random;
+    int numSamples = 0;
+};
@@ -0,0 +1,153 @@
+#pragma once
+#include "DelayArena.h"
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
+#include <vector>
+
+// How a fractional (modulated) delay is read:
+//  - none: truncated to whole samples (zipper noise and pitch steps under modulation)
+//  - linear: two taps; cheap, but dulls the highs by a delay-dependent amount
+//  - lagrange3: four taps, third order; flat to well above 10 kHz at 48 kHz
+//  - allpass: two taps and one state per line; flat magnitude, only for slowly
+//    moving delays inside a feedback loop
+enum class DelayInterpolation { none, linear, lagrange3, allpass };
+
+// Circular delay line shared by the algorithmic engines.
+// Capacity is a power of two, so positions wrap with a bit mask instead of `%`.
+// The first `guard` samples are mirrored past the end, so any span of up to
+// `guard` samples can be read as one contiguous array. That allows whole-block
+// processing:
+//  - feedback (read before write): readSpan(delay, n) with delay >= n
+//  - feed-forward taps (write, then read): writeBlock(in, n), then readSpan(tap + n, n)
+// Memory is either owned or taken from a DelayArena region.
+// No JUCE dependency; nothing but prepare() allocates.
+template <typename Sample>
+class MaskedDelayLine
+{
+public:
+    MaskedDelayLine() = default;
+    MaskedDelayLine(const MaskedDelayLine&) = delete;
+    MaskedDelayLine& operator=(const MaskedDelayLine&) = delete;
+
+    // Holds delays of up to maxDelay samples and spans of up to maxBlock samples
+    void prepare(int maxDelay, int maxBlock = 0)
+    {
+        setSize(maxDelay, maxBlock);
+        owned.assign(static_cast<size_t>(capacity + guard), Sample());
+        storage = owned.data();
+    }
+
+    // As above, with the memory taken from an arena region. A counting region only
+    // records the size; the line must be prepared again before use.
+    void prepare(int maxDelay, int maxBlock, DelayArena::Region& memory)
+    {
+        static_assert(std::is_same_v<Sample, float>, "arenas hold floats");
+        setSize(maxDelay, maxBlock);
+        owned = {};
+        storage = memory.take(static_cast<size_t>(capacity + guard));
+    }
+
+    void reset()
+    {
+        if (storage != nullptr)
+            std::fill(storage, storage + capacity + guard, Sample());
+        writePos = 0;
+    }
+
+    int getMaxDelay() const { return capacity - 1; }
+    int getMaxBlock() const { return guard; }
+
+    // Sample pushed `delay` pushes ago (1 = the most recent one)
+    Sample read(int delay) const
+    {
+        return storage[(writePos - delay) & mask];
+    }
+
+    // Sample `delay` pushes ago for a fractional delay in [2, getMaxDelay() - 2].
+    // allpassState is the interpolator's memory; keep one per read position.
+    template <DelayInterpolation interpolation>
+    Sample readFractional(float delay, Sample& allpassState) const
+    {
+        if constexpr (interpolation == DelayInterpolation::none) {
+            return read(static_cast<int>(delay));
+        } else if constexpr (interpolation == DelayInterpolation::linear) {
+            const int d = static_cast<int>(delay);
+            const Sample f = static_cast<Sample>(delay - static_cast<float>(d));
+            const Sample x0 = read(d);
+            return x0 + f * (read(d + 1) - x0);
+        } else if constexpr (interpolation == DelayInterpolation::lagrange3) {
+            const int d = static_cast<int>(delay);
+            const Sample f = static_cast<Sample>(delay - static_cast<float>(d));
+            const Sample fp1 = f + 1, fm1 = f - 1, fm2 = f - 2;
+            return -f * fm1 * fm2 / 6 * read(d - 1) + fp1 * fm1 * fm2 / 2 * read(d)
+                 - fp1 * f * fm2 / 2 * read(d + 1) + fp1 * f * fm1 / 6 * read(d + 2);
+        } else {
+            // Fractions in [0.1, 1.1): near 0 the coefficient approaches 1 and rings
+            const int d = static_cast<int>(delay - 0.1f);
+            const Sample f = static_cast<Sample>(delay - static_cast<float>(d));
+            const Sample eta = (1 - f) / (1 + f);
+            allpassState = eta * (read(d) - allpassState) + read(d + 1);
+            return allpassState;
+        }
+    }
+
+    // As above, for the interpolations that keep no state
+    template <DelayInterpolation interpolation>
+    Sample readFractional(float delay) const
+    {
+        static_assert(interpolation != DelayInterpolation::allpass, "the allpass interpolator needs its state");
+        Sample unused {};
+        return readFractional<interpolation>(delay, unused);
+    }
+
+    void push(Sample x)
+    {
+        storage[writePos] = x;
+        if (writePos < guard)
+            storage[capacity + writePos] = x;
+        writePos = (writePos + 1) & mask;
+    }
+
+    // numSamples consecutive samples, oldest first, starting `delay` pushes ago;
+    // span[k] is what read(delay) returns after k more pushes, as long as delay >= numSamples
+    const Sample* readSpan(int delay, int numSamples) const
+    {
+        assert(numSamples <= guard && delay <= capacity);
+        return storage + ((writePos - delay) & mask);
+    }
+
+    void writeBlock(const Sample* source, int numSamples)
+    {
+        assert(numSamples <= capacity);
+        const int first = std::min(numSamples, capacity - writePos);
+        std::copy(source, source + first, storage + writePos);
+        std::copy(source + first, source + numSamples, storage);
+
+        // Keep the mirror of [0, guard) in step
+        if (writePos < guard)
+            std::copy(storage + writePos, storage + std::min(guard, writePos + first), storage + capacity + writePos);
+        if (numSamples > first)
+            std::copy(storage, storage + std::min(guard, numSamples - first), storage + capacity);
+
+        writePos = (writePos + numSamples) & mask;
+    }
+
+private:
+    void setSize(int maxDelay, int maxBlock)
+    {
+        capacity = 1;
+        while (capacity < std::max(maxDelay, maxBlock) + 1)
+            capacity <<= 1;
+        mask = capacity - 1;
+        guard = maxBlock;
+        writePos = 0;
+    }
+
+    Sample* storage = nullptr;     // [capacity] ring + [guard] mirror of its start
+    std::vector<Sample> owned;
+    int capacity = 1;
+    int mask = 0;
+    int guard = 0;
+    int writePos = 0;
+};
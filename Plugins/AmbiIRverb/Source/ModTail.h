@@ -1,27 +1,40 @@
 #pragma once
 #include <JuceHeader.h>
+#include "LfoBank.h"
 
+// Slow amplitude modulation of the wet signal, each channel at its own phase of
+// the shared LFO (so its rate is the engines' modRateHz)
 class ModTail {
 public:
-    void prepare(const juce::dsp::ProcessSpec& spec){ sr = spec.sampleRate; }
-    void setRate(float hz){ rate = hz; }
-    void setDepth(float d){ depth = d; }
-    void process(juce::AudioBuffer<float>& buf){
-        if (depth <= 0.0001f) return;
+    void prepare(const juce::dsp::ProcessSpec& spec){
+        depth.reset(spec.sampleRate, rampSeconds);
+        offsets.clear();
+        for (juce::uint32 ch=0; ch<spec.numChannels; ++ch)
+            offsets.push_back(LfoBank::PhaseOffset::fromTurns(ch*0.13));
+    }
+    void setDepth(float d){ depth.setTargetValue(d); }
+    // lfo holds this block's modulation
+    void process(juce::AudioBuffer<float>& buf, const LfoBank& lfo){
         const int n = buf.getNumSamples();
-        const float modAmp = depth * 0.0005f;
-        for (int ch=0; ch<buf.getNumChannels(); ++ch){
-            auto* x = buf.getWritePointer(ch);
-            for (int i=0; i<n; ++i){
-                float ph = 2.0f * juce::MathConstants<float>::pi * (phase + i / sr * rate + ch*0.13f);
-                x[i] = x[i] + modAmp * std::sin(ph) * x[i];
+        if (!depth.isSmoothing() && depth.getTargetValue() <= 0.0001f)
+            return;
+        if (lfo.getNumSamples() < n) {   // Longer than prepared: leave it unmodulated
+            depth.skip(n);
+            return;
+        }
+        const int numChannels = juce::jmin(buf.getNumChannels(), (int) offsets.size());
+        const float* sine = lfo.getSine();
+        const float* cosine = lfo.getCosine();
+        for (int i=0; i<n; ++i){
+            const float modAmp = depth.getNextValue() * 0.0005f;
+            for (int ch=0; ch<numChannels; ++ch){
+                auto* x = buf.getWritePointer(ch);
+                x[i] = x[i] + modAmp * offsets[(size_t) ch].apply(sine[i], cosine[i]) * x[i];
             }
         }
-        phase += n / sr * rate;
-        phase -= std::floor(phase);
     }
 private:
-    double sr = 48000.0;
-    float rate = 0.3f, depth = 0.0f;
-    float phase = 0.0f;
+    static constexpr double rampSeconds = 0.05;
+    juce::SmoothedValue<float> depth { 0.0f };   // Glide per sample
+    std::vector<LfoBank::PhaseOffset> offsets;   // Per channel
 };
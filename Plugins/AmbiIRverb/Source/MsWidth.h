@@ -3,20 +3,31 @@
 
 class MsWidth {
 public:
-    void prepare(const juce::dsp::ProcessSpec&){}
-    void setWidth(float w){ width = w; }
+    void prepare(const juce::dsp::ProcessSpec& spec){ width.reset(spec.sampleRate, rampSeconds); }
+    void setWidth(float w){ width.setTargetValue(w); }
     void process(juce::AudioBuffer<float>& buf){
         auto n = buf.getNumSamples();
         if (buf.getNumChannels() < 2) return;
         auto* L = buf.getWritePointer(0);
         auto* R = buf.getWritePointer(1);
+        if (!width.isSmoothing()) {
+            const float w = width.getTargetValue();
+            for (int i=0;i<n;++i){
+                float M = 0.5f*(L[i]+R[i]);
+                float S = 0.5f*(L[i]-R[i]) * w;
+                L[i] = M + S;
+                R[i] = M - S;
+            }
+            return;
+        }
         for (int i=0;i<n;++i){
             float M = 0.5f*(L[i]+R[i]);
-            float S = 0.5f*(L[i]-R[i]) * width;
+            float S = 0.5f*(L[i]-R[i]) * width.getNextValue();
             L[i] = M + S;
             R[i] = M - S;
         }
     }
 private:
-    float width = 1.0f; // 0..2
+    static constexpr double rampSeconds = 0.05;
+    juce::SmoothedValue<float> width { 1.0f }; // 0..2, glides per sample
 };
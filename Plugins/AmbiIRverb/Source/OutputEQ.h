@@ -1,32 +1,43 @@
 #pragma once
 #include <JuceHeader.h>
 
+// Low shelf, mid peak and high shelf. Gain changes glide over rampSeconds; the
+// coefficients are only recomputed (in place, without allocating) while they do.
 class OutputEQ {
 public:
     void prepare(const juce::dsp::ProcessSpec& spec){
-        chain.prepare(spec);
         fs = spec.sampleRate;
+        for (auto& gain : gains)
+            gain.reset(fs, rampSeconds);
         update();
+        chain.prepare(spec);
     }
+    // Gains in dB; call on change only
     void setGains(float lo, float mid, float hi){
-        loGain = lo; midGain = mid; hiGain = hi; update();
+        gains[0].setTargetValue(lo); gains[1].setTargetValue(mid); gains[2].setTargetValue(hi);
     }
     void process(juce::AudioBuffer<float>& buf){
+        if (gains[0].isSmoothing() || gains[1].isSmoothing() || gains[2].isSmoothing()) {
+            for (auto& gain : gains)
+                gain.skip(buf.getNumSamples());
+            update();
+        }
         juce::dsp::AudioBlock<float> block(buf);
         juce::dsp::ProcessContextReplacing<float> ctx(block);
         chain.process(ctx);
     }
 private:
+    static constexpr double rampSeconds = 0.05;
+    using Coefficients = juce::dsp::IIR::ArrayCoefficients<float>;
+    using Filter = juce::dsp::ProcessorDuplicator<juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Coefficients<float>>;
+
     void update(){
         auto& lo = chain.get<0>(); auto& mid = chain.get<1>(); auto& hi = chain.get<2>();
-        *lo.state = *juce::dsp::IIR::Coefficients<float>::makeLowShelf (fs, 120.0f, 0.707f, juce::Decibels::decibelsToGain(loGain));
-        *mid.state= *juce::dsp::IIR::Coefficients<float>::makePeakFilter(fs, 2000.0f, 0.8f, juce::Decibels::decibelsToGain(midGain));
-        *hi.state = *juce::dsp::IIR::Coefficients<float>::makeHighShelf(fs, 8000.0f, 0.707f, juce::Decibels::decibelsToGain(hiGain));
+        *lo.state = Coefficients::makeLowShelf (fs, 120.0f, 0.707f, juce::Decibels::decibelsToGain(gains[0].getCurrentValue()));
+        *mid.state= Coefficients::makePeakFilter(fs, 2000.0f, 0.8f, juce::Decibels::decibelsToGain(gains[1].getCurrentValue()));
+        *hi.state = Coefficients::makeHighShelf(fs, 8000.0f, 0.707f, juce::Decibels::decibelsToGain(gains[2].getCurrentValue()));
     }
     double fs = 48000.0;
-    float loGain=0, midGain=0, hiGain=0;
-    juce::dsp::ProcessorChain<
-        juce::dsp::IIR::Filter<float>,
-        juce::dsp::IIR::Filter<float>,
-        juce::dsp::IIR::Filter<float>> chain;
+    std::array<juce::SmoothedValue<float>, 3> gains;   // dB: low, mid, high
+    juce::dsp::ProcessorChain<Filter, Filter, Filter> chain;
 };
@@ -3,6 +3,21 @@ using APVTS = juce::AudioProcessorValueTreeState;
 
 static juce::NormalisableRange<float> percentRange() { return {0.0f, 100.0f}; }
 
+// Parameters that feed coefficient calculations, by group
+static const std::pair<const char*, Parameters::Group> groupedParameters[] = {
+    { "hpHz", Parameters::Group::inputFilters },
+    { "lpHz", Parameters::Group::inputFilters },
+    { "rtScale", Parameters::Group::engine },
+    { "width", Parameters::Group::engine },
+    { "depth", Parameters::Group::engine },
+    { "diffusion", Parameters::Group::engine },
+    { "modDepth", Parameters::Group::engine },
+    { "modRate", Parameters::Group::engine },
+    { "eqLoGain", Parameters::Group::outputEQ },
+    { "eqMidGain", Parameters::Group::outputEQ },
+    { "eqHiGain", Parameters::Group::outputEQ },
+};
+
 Parameters::Parameters(juce::AudioProcessor& proc)
 : apvts(proc, nullptr, "PARAMS", *createLayout())
 {
@@ -19,6 +34,25 @@ Parameters::Parameters(juce::AudioProcessor& proc)
     eqMidGain= dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("eqMidGain"));
     eqHiGain = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("eqHiGain"));
     mode     = dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter("mode"));
+    irLowLatency = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("irLowLatency"));
+    irBackgroundTail = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("irBackgroundTail"));
+    irHybridTail = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("irHybridTail"));
+
+    for (const auto& [id, group] : groupedParameters)
+        apvts.addParameterListener(id, this);
+}
+
+Parameters::~Parameters()
+{
+    for (const auto& [id, group] : groupedParameters)
+        apvts.removeParameterListener(id, this);
+}
+
+void Parameters::parameterChanged(const juce::String& parameterID, float)
+{
+    for (const auto& [id, group] : groupedParameters)
+        if (parameterID == id)
+            changes[static_cast<size_t>(group)].fetch_add(1, std::memory_order_release);
 }
 
 std::unique_ptr<APVTS::ParameterLayout> Parameters::createLayout()
@@ -41,6 +75,9 @@ std::unique_ptr<APVTS::ParameterLayout> Parameters::createLayout()
     p.push_back (std::make_unique<juce::AudioParameterFloat>("eqHiGain", "EQ High Gain dB", juce::NormalisableRange<float>(-12.f, 12.f), 0.f));
 
     p.push_back (std::make_unique<juce::AudioParameterChoice>("mode", "Mode", juce::StringArray{ "IR","Spring","Plate","Room","Hall" }, 0));
+    p.push_back (std::make_unique<juce::AudioParameterBool>("irLowLatency", "IR Low Latency", false));
+    p.push_back (std::make_unique<juce::AudioParameterBool>("irBackgroundTail", "IR Background Tail", false));
+    p.push_back (std::make_unique<juce::AudioParameterBool>("irHybridTail", "IR Hybrid Tail", false));
 
     return std::make_unique<APVTS::ParameterLayout>(p.begin(), p.end());
 }
@@ -6,9 +6,10 @@ struct AdvancedSnapshot
     juce::NamedValueSet data;
 };
 
-struct Parameters
+struct Parameters : private juce::AudioProcessorValueTreeState::Listener
 {
     Parameters(juce::AudioProcessor& proc);
+    ~Parameters() override;
 
     std::unique_ptr<juce::AudioProcessorValueTreeState::ParameterLayout> createLayout();
     AdvancedSnapshot getAdvancedSnapshot() const { return {}; }
@@ -27,4 +28,30 @@ struct Parameters
     juce::AudioParameterFloat* eqMidGain { nullptr };
     juce::AudioParameterFloat* eqHiGain { nullptr };
     juce::AudioParameterChoice* mode { nullptr };
+    juce::AudioParameterBool* irLowLatency { nullptr };
+    juce::AudioParameterBool* irBackgroundTail { nullptr };
+    juce::AudioParameterBool* irHybridTail { nullptr };
+
+    // Parameters whose derived state (filter coefficients, engine tables) is rebuilt
+    // when one of them changes. Each group counts its changes, so the audio thread
+    // only does that work after a real change.
+    enum class Group { inputFilters, engine, outputEQ };
+    static constexpr int numGroups = 3;
+
+    // True once per batch of changes to `group` since the caller last looked;
+    // `seen` is the caller's count. Audio thread.
+    bool consumeChange(Group group, juce::uint32& seen) const
+    {
+        const auto current = changes[static_cast<size_t>(group)].load(std::memory_order_acquire);
+        if (current == seen)
+            return false;
+        seen = current;
+        return true;
+    }
+
+private:
+    // Any thread (automation arrives on the audio thread); never blocks
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+
+    std::array<std::atomic<juce::uint32>, numGroups> changes {};
 };
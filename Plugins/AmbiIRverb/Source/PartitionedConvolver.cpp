@@ -0,0 +1,619 @@
+#include "PartitionedConvolver.h"
+
+//==============================================================================
+void ConvolutionStage::allocate(int newPartitionSize, int newNumSegments, int newNumInputs, int newNumOutputs,
+                                const std::vector<Path>& newPaths, int newDelayPartitions, int extraSlots)
+{
+    jassert(juce::isPowerOfTwo(newPartitionSize));
+
+    partitionSize = newPartitionSize;
+    fftSize = partitionSize * 2;
+    numBins = fftSize / 2 + 1;
+    numInputs = newNumInputs;
+    numOutputs = newNumOutputs;
+    paths = newPaths;
+    delayPartitions = newDelayPartitions;
+
+    int order = 0;
+    while ((1 << order) < fftSize) ++order;
+    fft = std::make_unique<juce::dsp::FFT>(order);
+    fftBuffer.assign(static_cast<size_t>(fftSize * 2), 0.0f);
+
+    numIRChannels = 0;
+    for (const auto& p : paths) {
+        jassert(p.input < numInputs && p.output < numOutputs);
+        numIRChannels = juce::jmax(numIRChannels, p.irChannel + 1);
+    }
+
+    numSegments = juce::jmax(1, newNumSegments);
+    numSlots = numSegments + delayPartitions + extraSlots;
+
+    inputSpectra.assign(static_cast<size_t>(numInputs * numSlots * spectrumSize()), 0.0f);
+    inputWindows.assign(static_cast<size_t>(numInputs * fftSize), 0.0f);
+    outputBlocks.assign(static_cast<size_t>(numOutputs * partitionSize), 0.0f);
+}
+
+void ConvolutionStage::prepare(int newPartitionSize, const juce::AudioBuffer<float>& ir, int startSample, int numSamples,
+                               int newNumInputs, int newNumOutputs, const std::vector<Path>& newPaths,
+                               int newDelayPartitions, int extraSlots)
+{
+    allocate(newPartitionSize, (numSamples + newPartitionSize - 1) / newPartitionSize,
+             newNumInputs, newNumOutputs, newPaths, newDelayPartitions, extraSlots);
+    jassert(numIRChannels <= ir.getNumChannels());
+
+    ownedSpectra.assign(static_cast<size_t>(numIRChannels * numSegments * spectrumSize()), 0.0f);
+    irSpectraData = ownedSpectra.data();
+
+    // Segments are zero-padded to the FFT size, so the last partitionSize samples
+    // of each overlap-save result are free of circular wrap-around. A thread asked to
+    // exit stops early; its caller discards the result.
+    for (int ch = 0; ch < numIRChannels; ++ch) {
+        const float* data = ir.getReadPointer(ch);
+        if (juce::Thread::currentThreadShouldExit())
+            break;
+        for (int s = 0; s < numSegments; ++s) {
+            const int offset = s * partitionSize;
+            const int length = juce::jmin(partitionSize, numSamples - offset);
+            std::fill(fftBuffer.begin(), fftBuffer.end(), 0.0f);
+            if (length > 0)
+                std::copy(data + startSample + offset, data + startSample + offset + length, fftBuffer.begin());
+            fft->performRealOnlyForwardTransform(fftBuffer.data(), true);
+            std::copy(fftBuffer.begin(), fftBuffer.begin() + spectrumSize(),
+                      ownedSpectra.begin() + static_cast<std::ptrdiff_t>((ch * numSegments + s) * spectrumSize()));
+        }
+    }
+
+    ConvolutionStage::reset();
+}
+
+void ConvolutionStage::prepare(int newPartitionSize, const float* irSpectra, int newNumSegments,
+                               int newNumInputs, int newNumOutputs, const std::vector<Path>& newPaths,
+                               int newDelayPartitions, int extraSlots)
+{
+    allocate(newPartitionSize, newNumSegments, newNumInputs, newNumOutputs, newPaths, newDelayPartitions, extraSlots);
+
+    ownedSpectra.clear();
+    irSpectraData = irSpectra;
+
+    ConvolutionStage::reset();
+}
+
+void ConvolutionStage::reset()
+{
+    std::fill(inputSpectra.begin(), inputSpectra.end(), 0.0f);
+    std::fill(inputWindows.begin(), inputWindows.end(), 0.0f);
+    std::fill(outputBlocks.begin(), outputBlocks.end(), 0.0f);
+    inputPos = 0;
+    currentSlot = 0;
+}
+
+void ConvolutionStage::multiplyAccumulate(const float* a, const float* b, float* dest, int bins)
+{
+    for (int k = 0; k < bins; ++k) {
+        const float re = a[2 * k] * b[2 * k] - a[2 * k + 1] * b[2 * k + 1];
+        const float im = a[2 * k] * b[2 * k + 1] + a[2 * k + 1] * b[2 * k];
+        dest[2 * k] += re;
+        dest[2 * k + 1] += im;
+    }
+}
+
+void ConvolutionStage::process(const float* const* inputs, float* const* outputs, int numSamples)
+{
+    int processed = 0;
+    while (processed < numSamples) {
+        const int toProcess = juce::jmin(numSamples - processed, partitionSize - inputPos);
+
+        for (int in = 0; in < numInputs; ++in) {
+            float* window = inputWindows.data() + static_cast<size_t>(in * fftSize);
+            std::copy(inputs[in] + processed, inputs[in] + processed + toProcess, window + partitionSize + inputPos);
+        }
+
+        for (int out = 0; out < numOutputs; ++out) {
+            const float* block = outputBlocks.data() + static_cast<size_t>(out * partitionSize);
+            for (int i = 0; i < toProcess; ++i)
+                outputs[out][processed + i] += block[inputPos + i];
+        }
+
+        inputPos += toProcess;
+        processed += toProcess;
+
+        if (inputPos == partitionSize) {
+            processPartition();
+            inputPos = 0;
+        }
+    }
+}
+
+void ConvolutionStage::processPartition()
+{
+    transformPartition();
+    convolvePartition(*fft, (currentSlot + delayPartitions) % numSlots, fftBuffer.data(), outputBlocks.data());
+    advanceSlot();
+}
+
+void ConvolutionStage::transformPartition()
+{
+    // Forward transform of the last two partitions, once per input
+    for (int in = 0; in < numInputs; ++in) {
+        float* window = inputWindows.data() + static_cast<size_t>(in * fftSize);
+        std::copy(window, window + fftSize, fftBuffer.begin());
+        std::fill(fftBuffer.begin() + fftSize, fftBuffer.end(), 0.0f);
+        fft->performRealOnlyForwardTransform(fftBuffer.data(), true);
+        std::copy(fftBuffer.begin(), fftBuffer.begin() + spectrumSize(), inputSpectrum(in, currentSlot));
+        std::copy(window + partitionSize, window + fftSize, window);
+    }
+}
+
+void ConvolutionStage::convolvePartition(const juce::dsp::FFT& transform, int newestSlot, float* scratch, float* dest) const
+{
+    const int specSize = spectrumSize();
+
+    for (int out = 0; out < numOutputs; ++out) {
+        std::fill(scratch, scratch + specSize, 0.0f);
+        for (const auto& p : paths) {
+            if (p.output != out) continue;
+            for (int s = 0; s < numSegments; ++s) {
+                const int slot = (newestSlot + s) % numSlots;
+                multiplyAccumulate(inputSpectrum(p.input, slot), irSpectrum(p.irChannel, s), scratch, numBins);
+            }
+        }
+
+        // Restore the conjugate-symmetric half expected by the real inverse transform
+        for (int k = numBins; k < fftSize; ++k) {
+            scratch[2 * k] = scratch[2 * (fftSize - k)];
+            scratch[2 * k + 1] = -scratch[2 * (fftSize - k) + 1];
+        }
+        transform.performRealOnlyInverseTransform(scratch);
+
+        std::copy(scratch + partitionSize, scratch + fftSize, dest + static_cast<size_t>(out * partitionSize));
+    }
+}
+
+//==============================================================================
+BackgroundConvolutionStage::BackgroundConvolutionStage()
+: juce::Thread("AmbiGlass IR Tail")
+{
+    for (auto& job : completedJob)
+        job.store(-1);
+}
+
+BackgroundConvolutionStage::~BackgroundConvolutionStage()
+{
+    stopThread(1000);
+}
+
+// One partition of extra delay is the worker's deadline; one extra slot keeps the
+// spectra it reads alive until it notices it has been overtaken
+void BackgroundConvolutionStage::prepare(int newPartitionSize, const juce::AudioBuffer<float>& ir, int startSample, int numSamples,
+                                         int newNumInputs, int newNumOutputs, const std::vector<Path>& newPaths)
+{
+    stopThread(1000);
+    ConvolutionStage::prepare(newPartitionSize, ir, startSample, numSamples,
+                              newNumInputs, newNumOutputs, newPaths, 1, 1);
+    prepareWorker();
+}
+
+void BackgroundConvolutionStage::prepare(int newPartitionSize, const float* irSpectra, int newNumSegments,
+                                         int newNumInputs, int newNumOutputs, const std::vector<Path>& newPaths)
+{
+    stopThread(1000);
+    ConvolutionStage::prepare(newPartitionSize, irSpectra, newNumSegments,
+                              newNumInputs, newNumOutputs, newPaths, 1, 1);
+    prepareWorker();
+}
+
+void BackgroundConvolutionStage::prepareWorker()
+{
+    int order = 0;
+    while ((1 << order) < fftSize) ++order;
+    workerFFT = std::make_unique<juce::dsp::FFT>(order);
+    workerScratch.assign(static_cast<size_t>(fftSize * 2), 0.0f);
+    results.assign(static_cast<size_t>(numResultSlots * numOutputs * partitionSize), 0.0f);
+
+    reset();
+}
+
+void BackgroundConvolutionStage::reset()
+{
+    stopThread(1000);
+
+    ConvolutionStage::reset();
+    for (auto& job : completedJob)
+        job.store(-1);
+    submittedJob.store(-1);
+    nextJob = 0;
+
+    if (numSegments > 0)
+        startThread(juce::Thread::Priority::high);
+}
+
+void BackgroundConvolutionStage::processPartition()
+{
+    transformPartition();
+
+    // Result of the previous partition is due now, one partition after submission
+    const juce::int64 due = nextJob - 1;
+    if (due >= 0) {
+        const int resultSlot = static_cast<int>(due % numResultSlots);
+        if (completedJob[static_cast<size_t>(resultSlot)].load(std::memory_order_acquire) == due) {
+            const float* result = results.data() + static_cast<size_t>(resultSlot * numOutputs * partitionSize);
+            std::copy(result, result + numOutputs * partitionSize, outputBlocks.begin());
+        } else {
+            // Worker is late: compute the same partition here so the output stays deterministic
+            convolvePartition(*fft, slotForJob(due), fftBuffer.data(), outputBlocks.data());
+            numFallbacks.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    submittedJob.store(nextJob, std::memory_order_release);
+    ++nextJob;
+    advanceSlot();
+}
+
+void BackgroundConvolutionStage::run()
+{
+    juce::int64 lastDone = -1;
+
+    while (!threadShouldExit()) {
+        const juce::int64 job = submittedJob.load(std::memory_order_acquire);
+        if (job <= lastDone) {
+            wait(1);
+            continue;
+        }
+
+        // Only the newest job is still useful; older ones were already due
+        const int resultSlot = static_cast<int>(job % numResultSlots);
+        float* result = results.data() + static_cast<size_t>(resultSlot * numOutputs * partitionSize);
+        convolvePartition(*workerFFT, slotForJob(job), workerScratch.data(), result);
+
+        // Publish only if the audio thread has not moved past this job meanwhile
+        if (submittedJob.load(std::memory_order_acquire) == job)
+            completedJob[static_cast<size_t>(resultSlot)].store(job, std::memory_order_release);
+        lastDone = job;
+    }
+}
+
+//==============================================================================
+std::vector<PartitionedConvolver::Path> PartitionedConvolver::matrixPaths(int numInputs, int numOutputs)
+{
+    std::vector<Path> result;
+    for (int out = 0; out < numOutputs; ++out)
+        for (int in = 0; in < numInputs; ++in)
+            result.push_back({ in, out, out * numInputs + in });
+    return result;
+}
+
+std::vector<PartitionedConvolver::Path> PartitionedConvolver::diagonalPaths(int numChannels, bool sharedIR)
+{
+    std::vector<Path> result;
+    for (int ch = 0; ch < numChannels; ++ch)
+        result.push_back({ ch, ch, sharedIR ? 0 : ch });
+    return result;
+}
+
+void PartitionedConvolver::prepare(int maximumBlockSize, bool useLowLatency, bool useBackgroundTail)
+{
+    maxBlockSize = juce::jmax(1, maximumBlockSize);
+    lowLatency = useLowLatency;
+    backgroundTail = useLowLatency && useBackgroundTail;
+
+    stages.clear();
+    tail.reset();
+    paths.clear();
+    headTaps.clear();
+    inputHistory.clear();
+    inputScratch.clear();
+    inputPointers.clear();
+    numInputs = numOutputs = irLength = directLength = 0;
+}
+
+void PartitionedConvolver::reset()
+{
+    std::fill(inputHistory.begin(), inputHistory.end(), 0.0f);
+    for (auto& stage : stages)
+        stage->reset();
+    if (tail != nullptr)
+        tail->reset();
+}
+
+int PartitionedConvolver::setPaths(int newNumInputs, int newNumOutputs, const std::vector<Path>& newPaths, int newIRLength)
+{
+    numInputs = newNumInputs;
+    numOutputs = newNumOutputs;
+    paths = newPaths;
+    irLength = newIRLength;
+
+    inputScratch.assign(static_cast<size_t>(numInputs * maxBlockSize), 0.0f);
+    inputPointers.assign(static_cast<size_t>(numInputs), nullptr);
+    stages.clear();
+    spectraStorage.reset();
+    tail.reset();
+
+    int numIRChannels = 0;
+    for (const auto& p : paths)
+        numIRChannels = juce::jmax(numIRChannels, p.irChannel + 1);
+    return numIRChannels;
+}
+
+void PartitionedConvolver::setImpulseResponse(const juce::AudioBuffer<float>& ir, int newNumInputs, int newNumOutputs,
+                                              const std::vector<Path>& newPaths)
+{
+    const int numIRChannels = setPaths(newNumInputs, newNumOutputs, newPaths, ir.getNumSamples());
+
+    if (!lowLatency) {
+        auto stage = std::make_unique<ConvolutionStage>();
+        stage->prepare(uniformPartitionSize(maxBlockSize), ir, 0, irLength, numInputs, numOutputs, paths);
+        stages.push_back(std::move(stage));
+        directLength = 0;
+        headTaps.clear();
+        inputHistory.clear();
+        return;
+    }
+
+    // Direct head covers [0, headLength); a stage with partition P starts at IR offset P,
+    // which hides its P samples of latency, and covers [P, 4P) until the largest size.
+    // A background tail stage needs 2P of head room, so the stage before it is stretched
+    // up to 2 * maxPartitionSize.
+    directLength = juce::jmin(headLength, irLength);
+    headTaps.assign(static_cast<size_t>(numIRChannels * directLength), 0.0f);
+    for (int ch = 0; ch < numIRChannels; ++ch)
+        std::copy(ir.getReadPointer(ch), ir.getReadPointer(ch) + directLength,
+                  headTaps.begin() + static_cast<std::ptrdiff_t>(ch * directLength));
+    inputHistory.assign(static_cast<size_t>(numInputs * (directLength - 1 + maxBlockSize)), 0.0f);
+
+    int start = headLength;
+    for (int partition = headLength; start < irLength; partition *= 4) {
+        if (backgroundTail && partition == maxPartitionSize) {
+            jassert(start == 2 * maxPartitionSize);
+            auto stage = std::make_unique<BackgroundConvolutionStage>();
+            stage->prepare(partition, ir, start, irLength - start, numInputs, numOutputs, paths);
+            stages.push_back(std::move(stage));
+            break;
+        }
+
+        int end = partition < maxPartitionSize ? juce::jmin(irLength, partition * 4) : irLength;
+        if (backgroundTail && partition * 4 == maxPartitionSize)
+            end = juce::jmin(irLength, 2 * maxPartitionSize);
+
+        auto stage = std::make_unique<ConvolutionStage>();
+        stage->prepare(partition, ir, start, end - start, numInputs, numOutputs, paths);
+        stages.push_back(std::move(stage));
+        start = end;
+    }
+}
+
+void PartitionedConvolver::setTail(const FDNTail::Settings& settings)
+{
+    jassert(numInputs > 0 && numOutputs > 0);
+    tail = std::make_unique<FDNTail>();
+    tail->prepare(settings, numInputs, numOutputs);
+}
+
+//==============================================================================
+// Cache layout, all 32-bit little-endian:
+//   magic, version, numInputs, numOutputs, irLength, maxBlockSize, lowLatency, backgroundTail,
+//   numPaths, numIRChannels, directLength, numStages,
+//   paths (input, output, irChannel) * numPaths, headTaps [irChannel][directLength],
+//   per stage: background, partitionSize, numSegments, padding to 16 bytes,
+//              spectra [irChannel][segment][bin]
+//   hasTail, then if set: predelay, sampleRate, rt60 [band], outputGains [output][band] (floats)
+static constexpr int spectraMagic = 0x50534741; // "AGSP"
+static constexpr int spectraVersion = 2;
+
+static void padTo16(juce::OutputStream& out)
+{
+    while (out.getPosition() % 16 != 0)
+        out.writeByte(0);
+}
+
+void PartitionedConvolver::writeSpectra(juce::OutputStream& out) const
+{
+    int numIRChannels = 0;
+    for (const auto& p : paths)
+        numIRChannels = juce::jmax(numIRChannels, p.irChannel + 1);
+
+    for (int v : { spectraMagic, spectraVersion, numInputs, numOutputs, irLength, maxBlockSize,
+                   int(lowLatency), int(backgroundTail), static_cast<int>(paths.size()),
+                   numIRChannels, directLength, static_cast<int>(stages.size()) })
+        out.writeInt(v);
+    for (const auto& p : paths) {
+        out.writeInt(p.input);
+        out.writeInt(p.output);
+        out.writeInt(p.irChannel);
+    }
+    for (float tap : headTaps)
+        out.writeFloat(tap);
+
+    for (const auto& stage : stages) {
+        out.writeInt(dynamic_cast<const BackgroundConvolutionStage*>(stage.get()) != nullptr ? 1 : 0);
+        out.writeInt(stage->getPartitionSize());
+        out.writeInt(stage->getNumSegments());
+        padTo16(out);
+        const size_t numFloats = static_cast<size_t>(stage->getNumIRChannels() * stage->getNumSegments())
+                               * static_cast<size_t>(ConvolutionStage::spectrumSizeFor(stage->getPartitionSize()));
+        for (size_t i = 0; i < numFloats; ++i)
+            out.writeFloat(stage->getIRSpectra()[i]);
+    }
+
+    out.writeInt(tail != nullptr ? 1 : 0);
+    if (tail != nullptr) {
+        const auto& settings = tail->getSettings();
+        out.writeInt(settings.predelay);
+        out.writeFloat(static_cast<float>(settings.sampleRate));
+        for (float rt : settings.rt60)
+            out.writeFloat(rt);
+        for (int i = 0; i < numOutputs * FDNTail::numBands; ++i)
+            out.writeFloat(i < static_cast<int>(settings.outputGains.size()) ? settings.outputGains[static_cast<size_t>(i)] : 0.0f);
+    }
+}
+
+bool PartitionedConvolver::readSpectra(const void* data, size_t size, std::shared_ptr<const void> storage)
+{
+    static_assert(sizeof(float) == sizeof(juce::int32), "cache stores 32-bit floats");
+    if (juce::ByteOrder::isBigEndian())
+        return false; // Spectra are used in place, so only little-endian hosts can read them
+
+    const auto* base = static_cast<const char*>(data);
+    size_t pos = 0;
+    bool ok = (reinterpret_cast<juce::pointer_sized_uint>(base) % 16) == 0;
+    auto readInt = [&]() -> int {
+        if (!ok || pos + 4 > size) { ok = false; return 0; }
+        const int v = static_cast<int>(juce::ByteOrder::littleEndianInt(base + pos));
+        pos += 4;
+        return v;
+    };
+    auto readFloats = [&](size_t count) -> const float* {
+        if (!ok || count > (size - pos) / sizeof(float)) { ok = false; return nullptr; }
+        const auto* floats = reinterpret_cast<const float*>(base + pos);
+        pos += count * sizeof(float);
+        return floats;
+    };
+
+    const int magic = readInt(), version = readInt();
+    const int newNumInputs = readInt(), newNumOutputs = readInt(), newIRLength = readInt();
+    const int blockSize = readInt(), isLowLatency = readInt(), isBackgroundTail = readInt();
+    const int numPaths = readInt(), numIRChannels = readInt(), newDirectLength = readInt(), numStages = readInt();
+
+    // Only the uniform partition size depends on the block size; the low-latency layout
+    // sizes its input history for this convolver's block size below
+    const bool layoutMatches = lowLatency || uniformPartitionSize(blockSize) == uniformPartitionSize(maxBlockSize);
+    if (!ok || magic != spectraMagic || version != spectraVersion || !layoutMatches
+        || isLowLatency != int(lowLatency) || isBackgroundTail != int(backgroundTail)
+        || newNumInputs <= 0 || newNumOutputs <= 0 || newNumOutputs > 16 || numPaths <= 0
+        || numIRChannels <= 0 || newDirectLength < 0 || newDirectLength > headLength || numStages < 0)
+        return false;
+
+    std::vector<Path> newPaths;
+    for (int i = 0; i < numPaths && ok; ++i) {
+        Path p { readInt(), readInt(), readInt() };
+        if (p.input < 0 || p.input >= newNumInputs || p.output < 0 || p.output >= newNumOutputs
+            || p.irChannel < 0 || p.irChannel >= numIRChannels)
+            return false;
+        newPaths.push_back(p);
+    }
+    const float* taps = readFloats(static_cast<size_t>(numIRChannels * newDirectLength));
+    if (!ok) return false;
+
+    setPaths(newNumInputs, newNumOutputs, newPaths, newIRLength);
+    directLength = newDirectLength;
+    headTaps.assign(taps, taps + numIRChannels * directLength);
+    inputHistory.assign(directLength > 0 ? static_cast<size_t>(numInputs * (directLength - 1 + maxBlockSize)) : 0, 0.0f);
+
+    for (int i = 0; i < numStages; ++i) {
+        const int isBackground = readInt(), partition = readInt(), numSegments = readInt();
+        if (!ok || partition < 64 || !juce::isPowerOfTwo(partition) || numSegments <= 0)
+            break;
+        pos = (pos + 15) & ~static_cast<size_t>(15);
+        const float* spectra = readFloats(static_cast<size_t>(numIRChannels * numSegments)
+                                          * static_cast<size_t>(ConvolutionStage::spectrumSizeFor(partition)));
+        if (!ok) break;
+
+        if (isBackground != 0) {
+            auto stage = std::make_unique<BackgroundConvolutionStage>();
+            stage->prepare(partition, spectra, numSegments, numInputs, numOutputs, paths);
+            stages.push_back(std::move(stage));
+        } else {
+            auto stage = std::make_unique<ConvolutionStage>();
+            stage->prepare(partition, spectra, numSegments, numInputs, numOutputs, paths);
+            stages.push_back(std::move(stage));
+        }
+    }
+
+    if (ok && static_cast<int>(stages.size()) == numStages && readInt() != 0) {
+        FDNTail::Settings settings;
+        settings.predelay = readInt();
+        if (const float* values = readFloats(static_cast<size_t>(1 + FDNTail::numBands + numOutputs * FDNTail::numBands))) {
+            settings.sampleRate = values[0];
+            std::copy(values + 1, values + 1 + FDNTail::numBands, settings.rt60.begin());
+            settings.outputGains.assign(values + 1 + FDNTail::numBands, values + 1 + FDNTail::numBands * (1 + numOutputs));
+            ok = ok && settings.predelay >= 0 && settings.sampleRate > 0.0;
+            if (ok)
+                setTail(settings);
+        }
+    }
+
+    if (!ok || static_cast<int>(stages.size()) != numStages) {
+        prepare(maxBlockSize, lowLatency, backgroundTail);
+        return false;
+    }
+
+    spectraStorage = std::move(storage);
+    return true;
+}
+
+int PartitionedConvolver::getNumTailFallbacks() const
+{
+    int total = 0;
+    for (const auto& stage : stages)
+        if (auto* background = dynamic_cast<const BackgroundConvolutionStage*>(stage.get()))
+            total += background->getNumFallbacks();
+    return total;
+}
+
+void PartitionedConvolver::processDirectHead(int numSamples, float* const* outputs)
+{
+    const int historyLength = directLength - 1 + maxBlockSize;
+
+    for (int in = 0; in < numInputs; ++in) {
+        float* history = inputHistory.data() + static_cast<size_t>(in * historyLength);
+        std::copy(inputPointers[static_cast<size_t>(in)], inputPointers[static_cast<size_t>(in)] + numSamples,
+                  history + directLength - 1);
+    }
+
+    for (const auto& p : paths) {
+        const float* history = inputHistory.data() + static_cast<size_t>(p.input * historyLength) + directLength - 1;
+        const float* taps = headTaps.data() + static_cast<size_t>(p.irChannel * directLength);
+        float* out = outputs[p.output];
+        for (int i = 0; i < numSamples; ++i) {
+            float sum = 0.0f;
+            for (int k = 0; k < directLength; ++k)
+                sum += taps[k] * history[i - k];
+            out[i] += sum;
+        }
+    }
+
+    // Keep the last directLength - 1 input samples for the next call
+    for (int in = 0; in < numInputs; ++in) {
+        float* history = inputHistory.data() + static_cast<size_t>(in * historyLength);
+        std::copy(history + numSamples, history + numSamples + directLength - 1, history);
+    }
+}
+
+void PartitionedConvolver::process(const float* const* inputs, float* const* outputs, int numSamples)
+{
+    if (irLength == 0) {
+        for (int out = 0; out < numOutputs; ++out)
+            std::fill(outputs[out], outputs[out] + numSamples, 0.0f);
+        return;
+    }
+
+    int processed = 0;
+    while (processed < numSamples) {
+        const int toProcess = juce::jmin(numSamples - processed, maxBlockSize);
+
+        // Copy inputs first so outputs may alias them
+        for (int in = 0; in < numInputs; ++in) {
+            float* scratch = inputScratch.data() + static_cast<size_t>(in * maxBlockSize);
+            std::copy(inputs[in] + processed, inputs[in] + processed + toProcess, scratch);
+            inputPointers[static_cast<size_t>(in)] = scratch;
+        }
+
+        float* blockOutputs[16];
+        jassert(numOutputs <= 16);
+        for (int out = 0; out < numOutputs; ++out) {
+            blockOutputs[out] = outputs[out] + processed;
+            std::fill(blockOutputs[out], blockOutputs[out] + toProcess, 0.0f);
+        }
+
+        if (directLength > 0)
+            processDirectHead(toProcess, blockOutputs);
+
+        for (auto& stage : stages)
+            stage->process(inputPointers.data(), blockOutputs, toProcess);
+
+        if (tail != nullptr)
+            tail->process(inputPointers.data(), blockOutputs, toProcess);
+
+        processed += toProcess;
+    }
+}
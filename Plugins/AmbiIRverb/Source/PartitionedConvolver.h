@@ -0,0 +1,220 @@
+#pragma once
+#include <JuceHeader.h>
+#include "FDNTail.h"
+
+// One uniformly partitioned overlap-save stage for an N-in/M-out IR matrix.
+// Covers an IR segment with partitions of `partitionSize` samples; output lags
+// the input by partitionSize (plus `delayPartitions` whole partitions).
+// Each input partition is transformed once and multiply-accumulated into every
+// output it feeds, so a partition costs one forward FFT per input and one
+// inverse FFT per output regardless of how many IR paths connect them.
+class ConvolutionStage
+{
+public:
+    virtual ~ConvolutionStage() = default;
+
+    struct Path
+    {
+        int input = 0;
+        int output = 0;
+        int irChannel = 0;
+    };
+
+    // Not real-time safe. Uses ir[startSample, startSample + numSamples) of each path's channel.
+    // extraSlots keeps additional input spectra alive for readers running behind.
+    void prepare(int partitionSize, const juce::AudioBuffer<float>& ir, int startSample, int numSamples,
+                 int numInputs, int numOutputs, const std::vector<Path>& paths,
+                 int delayPartitions = 0, int extraSlots = 0);
+    // Same, but uses already transformed spectra laid out as [irChannel][segment][bin]
+    // (e.g. from a memory-mapped cache) in place; they must outlive the stage.
+    void prepare(int partitionSize, const float* irSpectra, int numSegments,
+                 int numInputs, int numOutputs, const std::vector<Path>& paths,
+                 int delayPartitions = 0, int extraSlots = 0);
+    virtual void reset();
+
+    // Adds the stage output to outputs; inputs must not alias outputs.
+    virtual void process(const float* const* inputs, float* const* outputs, int numSamples);
+
+    int getPartitionSize() const { return partitionSize; }
+    int getLatencySamples() const { return partitionSize * (1 + delayPartitions); }
+    int getNumSegments() const { return numSegments; }
+    int getNumIRChannels() const { return numIRChannels; }
+    // [irChannel][segment][bin], (fftSize / 2 + 1) interleaved complex bins each
+    const float* getIRSpectra() const { return irSpectraData; }
+    static int spectrumSizeFor(int partitionSize) { return (partitionSize + 1) * 2; }
+
+protected:
+    static void multiplyAccumulate(const float* a, const float* b, float* dest, int numBins);
+    virtual void processPartition();
+    void allocate(int partitionSize, int numSegments, int numInputs, int numOutputs,
+                  const std::vector<Path>& paths, int delayPartitions, int extraSlots);
+
+    // Forward-transforms the completed input partition into currentSlot
+    void transformPartition();
+    // Sums all segments against the delay line ending at newestSlot and writes one
+    // partition per output to dest. Only reads shared state, so it may run on any thread
+    // with its own scratch (2 * fftSize floats).
+    void convolvePartition(const juce::dsp::FFT& transform, int newestSlot, float* scratch, float* dest) const;
+    void advanceSlot() { currentSlot = currentSlot > 0 ? currentSlot - 1 : numSlots - 1; }
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+    int partitionSize = 0;
+    int fftSize = 0;
+    int numBins = 0;         // fftSize / 2 + 1 complex bins
+    int numSegments = 0;
+    int numIRChannels = 0;
+    int delayPartitions = 0;
+    int numInputs = 0;
+    int numOutputs = 0;
+    std::vector<Path> paths;
+
+    int inputPos = 0;
+    int currentSlot = 0;
+    int numSlots = 0;        // numSegments + delayPartitions + extraSlots
+
+    std::vector<float> ownedSpectra;   // [irChannel][segment][bin], unless adopted
+    const float* irSpectraData = nullptr;
+    std::vector<float> inputSpectra;   // [input][slot][bin], frequency-domain delay line
+    std::vector<float> inputWindows;   // [input][2 * partitionSize], previous + current partition
+    std::vector<float> outputBlocks;   // [output][partitionSize], emitted over the next partition
+    std::vector<float> fftBuffer;
+
+    int spectrumSize() const { return numBins * 2; }
+    const float* irSpectrum(int irChannel, int segment) const
+    {
+        return irSpectraData + (static_cast<size_t>(irChannel * numSegments + segment) * spectrumSize());
+    }
+    float* inputSpectrum(int in, int slot)
+    {
+        return inputSpectra.data() + (static_cast<size_t>(in * numSlots + slot) * spectrumSize());
+    }
+    const float* inputSpectrum(int in, int slot) const
+    {
+        return inputSpectra.data() + (static_cast<size_t>(in * numSlots + slot) * spectrumSize());
+    }
+};
+
+// Stage whose multiply-accumulate and inverse FFT run on a dedicated worker thread.
+// The audio thread only transforms each completed input partition and submits it;
+// results come back through a small ring of result slots tagged with their job index.
+// The output is due one partition later than a synchronous stage (latency 2 * partitionSize),
+// which gives the worker a whole partition of time. If the result is not ready when due,
+// the audio thread computes the identical result itself, so the output never depends on
+// thread timing. Nothing on the audio side locks, waits or allocates.
+class BackgroundConvolutionStage : public ConvolutionStage,
+                                   private juce::Thread
+{
+public:
+    BackgroundConvolutionStage();
+    ~BackgroundConvolutionStage() override;
+
+    // Not real-time safe; (re)starts the worker.
+    void prepare(int partitionSize, const juce::AudioBuffer<float>& ir, int startSample, int numSamples,
+                 int numInputs, int numOutputs, const std::vector<Path>& paths);
+    void prepare(int partitionSize, const float* irSpectra, int numSegments,
+                 int numInputs, int numOutputs, const std::vector<Path>& paths);
+    void reset() override;
+
+    int getNumFallbacks() const { return numFallbacks.load(std::memory_order_relaxed); }
+
+private:
+    void processPartition() override;
+    void run() override;
+    void prepareWorker();
+    int slotForJob(juce::int64 job) const { return static_cast<int>((numSlots - job % numSlots) % numSlots); }
+
+    static constexpr int numResultSlots = 2;
+
+    std::unique_ptr<juce::dsp::FFT> workerFFT;
+    std::vector<float> workerScratch;
+    std::vector<float> results;        // [resultSlot][output][partitionSize]
+    std::array<std::atomic<juce::int64>, numResultSlots> completedJob;
+    std::atomic<juce::int64> submittedJob { -1 };
+    std::atomic<int> numFallbacks { 0 };
+    juce::int64 nextJob = 0;           // audio thread only
+};
+
+// FFT convolution for an N-in/M-out IR matrix, built from ConvolutionStages.
+//  - Uniform: one stage partitioned at the host block size. Cheapest, but adds
+//    one partition of latency that must be reported to the host.
+//  - Low latency: the first `headLength` IR samples run as a direct FIR and later
+//    segments use progressively larger partitions (x4 per stage), giving zero added
+//    latency at roughly constant CPU for multi-second IRs. With backgroundTail the
+//    largest partitions (from 2 * maxPartitionSize on) are computed on a worker thread.
+// An optional FDNTail adds a synthetic late tail on top of a (truncated) early IR.
+// All scratch is allocated in prepare()/setImpulseResponse(); process() never allocates.
+class PartitionedConvolver
+{
+public:
+    using Path = ConvolutionStage::Path;
+
+    // Full matrix: IR channel (out * numInputs + in) feeds output `out` from input `in`
+    static std::vector<Path> matrixPaths(int numInputs, int numOutputs);
+    // Channel-wise: input n feeds output n through IR channel n (or channel 0 for a shared mono IR)
+    static std::vector<Path> diagonalPaths(int numChannels, bool sharedIR);
+
+    static int uniformPartitionSize(int maximumBlockSize) { return juce::nextPowerOfTwo(juce::jmax(64, maximumBlockSize)); }
+    static constexpr int headLength = 128;
+    static constexpr int maxPartitionSize = 8192;
+
+    void prepare(int maximumBlockSize, bool lowLatency, bool backgroundTail = false);
+    void reset();
+
+    // IR must already be at the processing sample rate. Not real-time safe.
+    void setImpulseResponse(const juce::AudioBuffer<float>& ir, int numInputs, int numOutputs,
+                            const std::vector<Path>& paths);
+    // Adds a feedback delay network tail after setImpulseResponse(), typically
+    // analysed from the part of the IR that was cut off. Not real-time safe.
+    void setTail(const FDNTail::Settings& settings);
+    bool hasTail() const { return tail != nullptr; }
+    
+    // Prepared IR (head taps and stage spectra) in a flat little-endian layout with
+    // 16-byte aligned spectra, for the on-disk cache. Not real-time safe.
+    void writeSpectra(juce::OutputStream& out) const;
+    // Restores an IR written by writeSpectra() after prepare() with the same settings.
+    // Spectra are used in place from `data`, which `storage` keeps alive (typically
+    // spectra shared through SharedIRStore). Returns false if the data is malformed or was built
+    // for a different layout.
+    bool readSpectra(const void* data, size_t size, std::shared_ptr<const void> storage);
+    bool hasImpulseResponse() const { return irLength > 0; }
+    int getIRLength() const { return irLength; }
+    int getNumInputs() const { return numInputs; }
+    int getNumOutputs() const { return numOutputs; }
+    int getLatencySamples() const { return lowLatency ? 0 : uniformPartitionSize(maxBlockSize); }
+    // How long an input sample can take to leave the output completely (latency, IR
+    // and any FDN tail)
+    int getMemorySamples() const { return getLatencySamples() + irLength + (tail != nullptr ? tail->getMemorySamples() : 0); }
+    // How long the response lasts: the (trimmed, stretched) IR, or the FDN tail's
+    // decay if that ends later
+    int getDecaySamples() const { return getLatencySamples() + juce::jmax(irLength, tail != nullptr ? tail->getDecaySamples() : 0); }
+    // Partitions the audio thread had to compute because the tail worker was late
+    int getNumTailFallbacks() const;
+
+    // Inputs and outputs may alias.
+    void process(const float* const* inputs, float* const* outputs, int numSamples);
+
+private:
+    void processDirectHead(int numSamples, float* const* outputs);
+    // Clears the stages and sizes the input scratch; returns the number of IR channels used
+    int setPaths(int numInputs, int numOutputs, const std::vector<Path>& paths, int irLength);
+
+    int maxBlockSize = 0;
+    bool lowLatency = false;
+    bool backgroundTail = false;
+    int numInputs = 0;
+    int numOutputs = 0;
+    int irLength = 0;
+    std::vector<Path> paths;
+
+    // Direct-form head (low-latency mode only)
+    int directLength = 0;
+    std::vector<float> headTaps;       // [irChannel][directLength]
+    std::vector<float> inputHistory;   // [input][directLength - 1 + maxBlockSize]
+
+    std::vector<std::unique_ptr<ConvolutionStage>> stages;
+    std::shared_ptr<const void> spectraStorage;  // Backs adopted stage spectra
+    std::unique_ptr<FDNTail> tail;
+
+    std::vector<float> inputScratch;   // [input][maxBlockSize]
+    std::vector<const float*> inputPointers;
+};
@@ -1,78 +1,80 @@
 #include "PlateEngine.h"
+#include <numeric>
 
 PlateEngine::PlateEngine()
 {
     params.timeScale = 1.0f;
-    params.diffusion = 0.6f;
+    params.diffusion = 60.0f;
     params.width = 1.0f;
     params.modDepth = 0.0f;
-    params.modRate = 0.3f;
+    params.modRateHz = 0.3f;
     
     // Initialize base delay lengths in samples (will be converted in prepare)
     // These are in milliseconds, will be converted based on sample rate
     std::array<int, numLines> delayMs = { 37, 87, 181, 271, 359, 449, 563, 641 };
     
-    // Initialize Householder matrix
-    initializeHouseholderMatrix();
+    initializeStereoVectors();
 }
 
-void PlateEngine::prepare(const juce::dsp::ProcessSpec& spec)
+size_t PlateEngine::getDelayMemorySize(const juce::dsp::ProcessSpec& spec)
 {
-    sampleRate = spec.sampleRate;
-    
-    // Calculate max delay needed (longest delay * max timeScale * 2 for safety)
-    int maxDelaySamples = static_cast<int>(spec.sampleRate * 0.3);  // 300ms max
-    int bufferSize = maxDelaySamples * 2;
-    
-    // Convert delay times from ms to samples
+    DelayArena::Region counter;
+    layoutDelays(spec.sampleRate, counter);
+    return counter.getUsed();
+}
+
+void PlateEngine::layoutDelays(double rate, DelayArena::Region& memory)
+{
+    // Delay times in ms, converted to samples at this rate
     std::array<int, numLines> delayMs = { 37, 87, 181, 271, 359, 449, 563, 641 };
     
-    for (size_t i = 0; i < delays.size(); ++i) {
-        baseDelaySamples[i] = static_cast<int>(delayMs[i] * spec.sampleRate / 1000.0);
-        delays[i].prepare(baseDelaySamples[i], bufferSize);
+    // Each line sized for the longest delay it can be asked for
+    std::array<int, numLines> maxDelays {};
+    for (int i = 0; i < numLines; ++i) {
+        baseDelaySamples[i] = static_cast<int>(delayMs[i] * rate / 1000.0);
+        maxDelays[i] = EngineLimits::getMaxDelaySamples(baseDelaySamples[i]);
     }
+    core.prepare(numLines, maxDelays.data(), memory);
+}
+
+void PlateEngine::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    sampleRate = spec.sampleRate;
     
-    // Prepare damping filters
-    for (size_t i = 0; i < dampingFilters.size(); ++i) {
-        dampingFilters[i].prepare(spec);
-        // Higher delay lines get more damping (simulate HF loss in plate)
-        float cutoff = 2000.0f + (i / static_cast<float>(numLines)) * 6000.0f;
-        dampingCoeffs[i] = juce::dsp::IIR::Coefficients<float>::makeLowPass(
-            spec.sampleRate, cutoff, 0.707f);
-        *dampingFilters[i].state = *dampingCoeffs[i];
+    auto memory = ownDelayMemory.assignedOrOwn(delayMemory, getDelayMemorySize(spec));
+    layoutDelays(spec.sampleRate, memory);
+    for (int i = 0; i < numLines; ++i) {
+        core.setBaseDelay(i, static_cast<float>(baseDelaySamples[i]));
+        core.setInputGains(i, inputGains[0][i], inputGains[1][i]);
+        core.setOutputTaps(i, outputTaps[0][i], outputTaps[1][i]);
     }
     
+    const auto blockSize = static_cast<size_t>(spec.maximumBlockSize);
+    delayScale.assign(blockSize, 1.0f);
+    wetLeft.assign(blockSize, 0.0f);
+    wetRight.assign(blockSize, 0.0f);
+    
     reset();
     updateParameters();
 }
 
 void PlateEngine::reset()
 {
-    for (auto& delay : delays) {
-        std::fill(delay.buffer.begin(), delay.buffer.end(), 0.0f);
-        delay.writePos = 0;
-    }
-    
-    modPhase = 0.0f;
+    core.reset();
 }
 
-void PlateEngine::initializeHouseholderMatrix()
+void PlateEngine::initializeStereoVectors()
 {
-    // Householder matrix: H = I - 2*v*v^T / (v^T*v)
-    // For 8x8: H[i][j] = (i==j ? 1 : 0) - 2/N
-    // Simplified: H[i][j] = (i==j ? 1-2/N : -2/N)
-    const float N = static_cast<float>(numLines);
-    const float scale = 2.0f / N;
-    
-    for (int i = 0; i < numLines; ++i) {
-        for (int j = 0; j < numLines; ++j) {
-            if (i == j) {
-                mixingMatrix[i][j] = 1.0f - scale;
-            } else {
-                mixingMatrix[i][j] = -scale;
-            }
-        }
-    }
+    // Walsh-Hadamard rows: entry (row, i) is -1 when row & i has odd parity. Row 0
+    // (all ones) is skipped: it is the Householder matrix's -1 eigenvector.
+    auto hadamardRow = [](int row) {
+        std::array<float, numLines> v;
+        for (int i = 0; i < numLines; ++i)
+            v[static_cast<size_t>(i)] = (juce::countNumberOfBits(static_cast<juce::uint32>(row & i)) & 1) ? -1.0f : 1.0f;
+        return v;
+    };
+    inputGains = { hadamardRow(1), hadamardRow(2) };
+    outputTaps = { hadamardRow(numLines - 1), hadamardRow(numLines / 2 - 1) };
 }
 
 void PlateEngine::updateParameters()
@@ -83,14 +85,28 @@ void PlateEngine::updateParameters()
     
     // Update damping based on diffusion (higher diffusion = more damping)
     float dampingAmount = params.diffusion / 100.0f;
-    for (size_t i = 0; i < dampingFilters.size(); ++i) {
+    for (size_t i = 0; i < dampingCoeffs.size(); ++i) {
         float baseCutoff = 2000.0f + (i / static_cast<float>(numLines)) * 6000.0f;
         float cutoff = baseCutoff * (1.0f - dampingAmount * 0.5f);  // Reduce with more diffusion
         cutoff = juce::jlimit(500.0f, 20000.0f, cutoff);
         
-        dampingCoeffs[i] = juce::dsp::IIR::Coefficients<float>::makeLowPass(
-            sampleRate, cutoff, 0.707f);
-        *dampingFilters[i].state = *dampingCoeffs[i];
+        dampingCoeffs[i] = juce::dsp::IIR::ArrayCoefficients<float>::makeLowPass(sampleRate, cutoff, 0.707f);
+    }
+    
+    // Delay modulation: each line follows the shared LFO at its own phase
+    core.setModulationDepth(params.modDepth > 0.01f ? params.modDepth * 0.0001f : 0.0f);
+    
+    updateCore();
+}
+
+void PlateEngine::updateCore()
+{
+    if (core.getNumLines() != numLines) return;  // Not prepared yet
+    
+    for (int i = 0; i < numLines; ++i) {
+        const auto& c = dampingCoeffs[static_cast<size_t>(i)];
+        core.setDamping(i, c[0] / c[3], c[1] / c[3], c[2] / c[3], c[4] / c[3], c[5] / c[3]);
+        core.setGains(i, 1.0f, feedbackGain);
     }
 }
 
@@ -98,65 +114,50 @@ void PlateEngine::process(juce::AudioBuffer<float>& buffer)
 {
     const int numSamples = buffer.getNumSamples();
     const int numChannels = buffer.getNumChannels();
+    float* left = buffer.getWritePointer(0);
+    float* right = numChannels > 1 ? buffer.getWritePointer(1) : nullptr;
     
-    // Calculate modulation
-    const float modIncrement = 2.0f * juce::MathConstants<float>::pi * params.modRateHz / static_cast<float>(sampleRate);
-    float modAmount = params.modDepth * 0.0001f;  // Very subtle modulation
+    // Mix dry/wet (plate character: mostly wet)
+    const float dryGain = 0.1f;
+    const float wetGain = 0.9f;
     
-    for (int sample = 0; sample < numSamples; ++sample) {
-        // Calculate modulation for delay lengths
-        float mod = 1.0f;
-        if (params.modDepth > 0.01f) {
-            mod = 1.0f + std::sin(modPhase) * modAmount;
-            modPhase += modIncrement;
-            if (modPhase > 2.0f * juce::MathConstants<float>::pi) {
-                modPhase -= 2.0f * juce::MathConstants<float>::pi;
-            }
-        }
+    // One network step per stereo frame, in blocks of the scratch size
+    const int maxBlock = static_cast<int>(delayScale.size());
+    if (maxBlock == 0) return;  // Not prepared yet
+    const bool modulated = lfo != nullptr && lfo->getNumSamples() >= numSamples;
+    for (int start = 0; start < numSamples; start += maxBlock) {
+        const int blockSize = juce::jmin(maxBlock, numSamples - start);
         
-        // Process each channel
-        for (int ch = 0; ch < numChannels; ++ch) {
-            float* channelData = buffer.getWritePointer(ch);
-            float input = channelData[sample];
-            
-            // Calculate scaled delay lengths
-            std::array<float, numLines> delayed;
-            for (size_t i = 0; i < delays.size(); ++i) {
-                int delaySamples = static_cast<int>(baseDelaySamples[i] * params.timeScale * mod);
-                delaySamples = juce::jlimit(1, static_cast<int>(delays[i].buffer.size()) - 1, delaySamples);
-                delayed[i] = delays[i].read(delaySamples);
-            }
-            
-            // Apply damping filters (process each sample)
-            for (size_t i = 0; i < dampingFilters.size(); ++i) {
-                delayed[i] = dampingFilters[i].processSample(delayed[i]);
-            }
-            
-            // Mix through Householder matrix
-            std::array<float, numLines> mixed;
-            for (int i = 0; i < numLines; ++i) {
-                mixed[i] = 0.0f;
-                for (int j = 0; j < numLines; ++j) {
-                    mixed[i] += mixingMatrix[i][j] * delayed[j];
-                }
-            }
-            
-            // Calculate output (sum of mixed signals)
-            float output = 0.0f;
-            for (int i = 0; i < numLines; ++i) {
-                output += mixed[i];
-            }
-            
-            // Write feedback to delays
-            for (size_t i = 0; i < delays.size(); ++i) {
-                delays[i].write(input + mixed[i] * feedbackGain);
+        // Delay lengths scale with time; the core adds its per-line modulation
+        std::fill(delayScale.begin(), delayScale.begin() + blockSize, params.timeScale);
+        
+        float* inL = left + start;
+        float* inR = right != nullptr ? right + start : inL;
+        core.process(inL, inR, wetLeft.data(), wetRight.data(), delayScale.data(),
+                     modulated ? lfo->getSine() + start : nullptr, modulated ? lfo->getCosine() + start : nullptr, blockSize);
+        
+        for (int sample = 0; sample < blockSize; ++sample) {
+            const size_t i = static_cast<size_t>(sample);
+            if (right != nullptr) {
+                inL[sample] = inL[sample] * dryGain + wetLeft[i] * wetGain;
+                inR[sample] = inR[sample] * dryGain + wetRight[i] * wetGain;
+            } else {
+                inL[sample] = inL[sample] * dryGain + 0.5f * (wetLeft[i] + wetRight[i]) * wetGain;
             }
-            
-            // Mix dry/wet (plate character: mostly wet)
-            const float dryGain = 0.1f;
-            const float wetGain = 0.9f;
-            
-            channelData[sample] = input * dryGain + output * wetGain;
         }
     }
 }
+
+double PlateEngine::getMemorySeconds() const
+{
+    // The longest line at the current time scale and full modulation
+    const int longest = *std::max_element(baseDelaySamples.begin(), baseDelaySamples.end());
+    return longest * params.timeScale * (1.0f + EngineLimits::maxModulation) / sampleRate;
+}
+
+double PlateEngine::getDecaySeconds() const
+{
+    // The Householder mix spreads energy over every line: one pass is the mean line
+    const double mean = std::accumulate(baseDelaySamples.begin(), baseDelaySamples.end(), 0.0) / numLines;
+    return getLoopDecaySeconds(mean * params.timeScale / sampleRate, feedbackGain);
+}
@@ -1,60 +1,52 @@
 #pragma once
 #include "HybridVerb.h"
+#include "FDNCore.h"
 #include <JuceHeader.h>
 
 class PlateEngine : public IReverbEngine {
 public:
     PlateEngine();
+    size_t getDelayMemorySize(const juce::dsp::ProcessSpec& spec) override;
+    void setDelayMemory(DelayArena::Region memory) override { delayMemory = memory; }
+    void setModulation(const LfoBank* bank) override { lfo = bank; }
     void prepare(const juce::dsp::ProcessSpec& spec) override;
     void reset() override;
     void setParams(const EngineParams& p) override { params = p; updateParameters(); }
     void process(juce::AudioBuffer<float>& buffer) override;
+    double getMemorySeconds() const override;
+    double getDecaySeconds() const override;
 
 private:
-    struct DelayLine {
-        std::vector<float> buffer;
-        int writePos = 0;
-        int baseDelaySamples = 0;
-        
-        void prepare(int delaySamples, int maxSize) {
-            baseDelaySamples = delaySamples;
-            buffer.resize(maxSize);
-            std::fill(buffer.begin(), buffer.end(), 0.0f);
-            writePos = 0;
-        }
-        
-        float read(int delaySamples) const {
-            int readPos = (writePos - delaySamples + static_cast<int>(buffer.size())) % static_cast<int>(buffer.size());
-            return buffer[readPos];
-        }
-        
-        void write(float sample) {
-            buffer[writePos] = sample;
-            writePos = (writePos + 1) % static_cast<int>(buffer.size());
-        }
-    };
-    
-    void initializeHouseholderMatrix();
+    // Places the delay lines in `memory` (or only counts, for getDelayMemorySize())
+    void layoutDelays(double sampleRate, DelayArena::Region& memory);
+    void initializeStereoVectors();
     void updateParameters();
+    // Pushes damping and gains to the core
+    void updateCore();
     
     EngineParams params;
     double sampleRate = 48000.0;
+    DelayArena::Region delayMemory;
+    DelayArena ownDelayMemory;  // Only when no region was set
+    const LfoBank* lfo = nullptr;
     
     // 8-line FDN
     static constexpr int numLines = 8;
-    std::array<DelayLine, numLines> delays;
-    std::array<int, numLines> baseDelaySamples;
+    FDNCore core;
+    std::array<int, numLines> baseDelaySamples {};
+    
+    // Stereo injection and pick-up: L and R enter and leave the network through
+    // different Walsh-Hadamard sign patterns, so the outputs are decorrelated
+    std::array<std::array<float, numLines>, 2> inputGains;
+    std::array<std::array<float, numLines>, 2> outputTaps;
     
-    // Householder mixing matrix
-    std::array<std::array<float, numLines>, numLines> mixingMatrix;
+    // Frequency-dependent damping, run by the core
+    // (b0, b1, b2, a0, a1, a2 per line; computed without allocating)
+    std::array<std::array<float, 6>, numLines> dampingCoeffs {};
     
-    // Frequency-dependent damping filters
-    std::array<juce::dsp::IIR::Filter<float>, numLines> dampingFilters;
-    std::array<juce::dsp::IIR::Coefficients<float>::Ptr, numLines> dampingCoeffs;
+    // Per-block scratch: delay scale (time) and the wet outputs
+    std::vector<float> delayScale, wetLeft, wetRight;
     
     // Feedback gain (controlled by diffusion)
     float feedbackGain = 0.7f;
-    
-    // Modulation
-    float modPhase = 0.0f;
 };
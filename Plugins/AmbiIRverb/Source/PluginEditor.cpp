@@ -75,6 +75,9 @@ AmbiGlassConvoVerbAudioProcessorEditor::AmbiGlassConvoVerbAudioProcessorEditor (
 
     modeBox.addItemList (juce::StringArray{ "IR", "Spring", "Plate", "Room", "Hall" }, 1);
     addAndMakeVisible(modeBox);
+    
+    activityLabel.setJustificationType(juce::Justification::right);
+    addAndMakeVisible(activityLabel);
 
     auto initKnob = [&](juce::Slider& s) {
         s.setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
@@ -105,6 +108,15 @@ AmbiGlassConvoVerbAudioProcessorEditor::AmbiGlassConvoVerbAudioProcessorEditor (
     savePresetButton.onClick = [this] { savePresetClicked(); };
     addAndMakeVisible(savePresetButton);
     
+    lowLatencyButton.setButtonText("Low Latency");
+    addAndMakeVisible(lowLatencyButton);
+    
+    backgroundTailButton.setButtonText("BG Tail");
+    addAndMakeVisible(backgroundTailButton);
+    
+    hybridTailButton.setButtonText("Hybrid");
+    addAndMakeVisible(hybridTailButton);
+    
     irInfoLabel.setText("No IR loaded", juce::dontSendNotification);
     irInfoLabel.setJustificationType(juce::Justification::left);
     addAndMakeVisible(irInfoLabel);
@@ -124,6 +136,11 @@ AmbiGlassConvoVerbAudioProcessorEditor::AmbiGlassConvoVerbAudioProcessorEditor (
     aEQL  = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(proc.parameters.apvts, "eqLoGain", eqLo);
     aEQM  = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(proc.parameters.apvts, "eqMidGain", eqMid);
     aEQH  = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(proc.parameters.apvts, "eqHiGain", eqHi);
+    aLowLat = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(proc.parameters.apvts, "irLowLatency", lowLatencyButton);
+    aBgTail = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(proc.parameters.apvts, "irBackgroundTail", backgroundTailButton);
+    aHybrid = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(proc.parameters.apvts, "irHybridTail", hybridTailButton);
+    
+    startTimerHz(4);
 }
 
 void AmbiGlassConvoVerbAudioProcessorEditor::paint (juce::Graphics& g)
@@ -143,6 +160,7 @@ void AmbiGlassConvoVerbAudioProcessorEditor::resized()
     auto area = getLocalBounds().reduced(12);
     auto top = area.removeFromTop(28);
     modeBox.setBounds(top.removeFromLeft(220));
+    activityLabel.setBounds(top.removeFromRight(140));
 
     auto knobRow = area.removeFromTop(160);
     auto w = knobRow.getWidth() / 6;
@@ -174,9 +192,25 @@ void AmbiGlassConvoVerbAudioProcessorEditor::resized()
     loadPresetButton.setBounds(buttonCol.removeFromTop(24).reduced(2));
     savePresetButton.setBounds(buttonCol.removeFromTop(24).reduced(2));
     
+    auto toggleCol = presetArea.removeFromLeft(110);
+    lowLatencyButton.setBounds(toggleCol.removeFromTop(24).reduced(2));
+    backgroundTailButton.setBounds(toggleCol.removeFromTop(24).reduced(2));
+    hybridTailButton.setBounds(toggleCol.removeFromTop(24).reduced(2));
+    
     irInfoLabel.setBounds(presetArea.reduced(4));
 }
 
+void AmbiGlassConvoVerbAudioProcessorEditor::timerCallback()
+{
+    const auto info = proc.getIRInfo();
+    if (info.isNotEmpty() && info != irInfoLabel.getText())
+        irInfoLabel.setText(info, juce::dontSendNotification);
+    
+    const auto activity = proc.isAsleep() ? juce::String("Sleeping")
+                                          : "Active " + juce::String(juce::roundToInt(proc.getActivity() * 100.0f)) + "%";
+    activityLabel.setText(activity, juce::dontSendNotification);
+}
+
 void AmbiGlassConvoVerbAudioProcessorEditor::loadIRClicked()
 {
     juce::FileChooser chooser("Load Impulse Response", {}, "*.wav;*.aiff;*.flac");
@@ -24,7 +24,8 @@ private:
     juce::Array<juce::File> presets;
 };
 
-class AmbiGlassConvoVerbAudioProcessorEditor : public juce::AudioProcessorEditor
+class AmbiGlassConvoVerbAudioProcessorEditor : public juce::AudioProcessorEditor,
+                                               private juce::Timer
 {
 public:
     AmbiGlassConvoVerbAudioProcessorEditor (AmbiGlassConvoVerbAudioProcessor&);
@@ -33,9 +34,14 @@ public:
     void resized() override;
 
 private:
+    // IRs load in the background and the chain sleeps on its own, so the info
+    // and activity labels follow the processor
+    void timerCallback() override;
+
     AmbiGlassConvoVerbAudioProcessor& proc;
 
     juce::ComboBox modeBox;
+    juce::Label activityLabel;
     juce::Slider timeKnob, widthKnob, depthKnob, diffusionKnob, modDepthKnob, modRateKnob;
     juce::Slider hpSlider, lpSlider, dryWetSlider;
     juce::Slider eqLo, eqMid, eqHi;
@@ -48,6 +54,10 @@ private:
     juce::TextButton loadIRButton;
     juce::TextButton loadPresetButton;
     juce::TextButton savePresetButton;
+    juce::ToggleButton lowLatencyButton;
+    juce::ToggleButton backgroundTailButton;
+    juce::ToggleButton hybridTailButton;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> aLowLat, aBgTail, aHybrid;
     juce::Label irInfoLabel;
 
     LiquidGlassLookAndFeel lg;
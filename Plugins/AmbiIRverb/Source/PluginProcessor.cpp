@@ -1,13 +1,21 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 #include "FileIO.h"
+#include "PartitionedConvolver.h"
 
 AmbiGlassConvoVerbAudioProcessor::AmbiGlassConvoVerbAudioProcessor()
 : AudioProcessor (BusesProperties()
     .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
     .withOutput ("Output", juce::AudioChannelSet::stereo(), true))
 , parameters(*this)
-{}
+{
+    parameters.apvts.addParameterListener("mode", this);
+}
+
+AmbiGlassConvoVerbAudioProcessor::~AmbiGlassConvoVerbAudioProcessor()
+{
+    parameters.apvts.removeParameterListener("mode", this);
+}
 
 bool AmbiGlassConvoVerbAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 {
@@ -19,31 +27,132 @@ void AmbiGlassConvoVerbAudioProcessor::prepareToPlay (double sr, int blockSize)
 {
     juce::dsp::ProcessSpec spec { sr, (juce::uint32) blockSize, 2 };
 
-    hpFilter.reset(); lpFilter.reset();
-    *hpFilter.state = *juce::dsp::IIR::Coefficients<float>::makeHighPass (sr, parameters.hpHz->get());
-    *lpFilter.state = *juce::dsp::IIR::Coefficients<float>::makeLowPass  (sr, parameters.lpHz->get());
+    // Everything starts at the current values; later changes are picked up per group
+    parameters.consumeChange(Parameters::Group::inputFilters, seenFilterChanges);
+    parameters.consumeChange(Parameters::Group::engine, seenEngineChanges);
+    parameters.consumeChange(Parameters::Group::outputEQ, seenEQChanges);
 
+    hpCutoff.reset(sr, smoothingSeconds);
+    hpCutoff.setCurrentAndTargetValue(parameters.hpHz->get());
+    lpCutoff.reset(sr, smoothingSeconds);
+    lpCutoff.setCurrentAndTargetValue(parameters.lpHz->get());
+    updateInputFilters();
+    hpFilter.prepare(spec);
+    lpFilter.prepare(spec);
+
+    diffuser.setAmount(parameters.diffusion->get());
     diffuser.prepare(spec);
+    // Mode and IR layout first, so prepare() builds its engine (and rebuilds the loaded IR) up front
+    hybrid.setMode((ReverbMode) parameters.mode->getIndex());
+    appliedLowLatency = parameters.irLowLatency->get();
+    hybrid.setIRLowLatency(appliedLowLatency);
+    appliedBackgroundTail = parameters.irBackgroundTail->get();
+    hybrid.setIRBackgroundTail(appliedBackgroundTail);
+    appliedHybridTail = parameters.irHybridTail->get();
+    hybrid.setIRHybridTail(appliedHybridTail);
+    engineParams.reset(sr, getEngineParams());
+    hybrid.setParams(getEngineParams());
     hybrid.prepare(spec);
+    modTail.setDepth(parameters.modDepth->get());
     modTail.prepare(spec);
+    outputEQ.setGains(parameters.eqLoGain->get(), parameters.eqMidGain->get(), parameters.eqHiGain->get());
     outputEQ.prepare(spec);
+    msWidth.setWidth(parameters.width->get());
     msWidth.prepare(spec);
 
     dryBuffer.setSize(2, blockSize);
+    dryWet.reset(sr, smoothingSeconds);
+    dryWet.setCurrentAndTargetValue(parameters.dryWet->get() * 0.01f);
+    quietOutputSamples = 0;
+    asleep = false;
+
+    dryDelay.setMaximumDelayInSamples(PartitionedConvolver::uniformPartitionSize(blockSize));
+    dryDelay.prepare(spec);
+    dryDelay.setDelay((float) hybrid.getLatencySamples());
+    setLatencySamples(hybrid.getLatencySamples());
+}
+
+void AmbiGlassConvoVerbAudioProcessor::handleAsyncUpdate()
+{
+    const bool lowLatency = parameters.irLowLatency->get();
+    if (lowLatency != appliedLowLatency) {
+        hybrid.setIRLowLatency(lowLatency);
+        appliedLowLatency = lowLatency;
+    }
+    const bool backgroundTail = parameters.irBackgroundTail->get();
+    if (backgroundTail != appliedBackgroundTail) {
+        hybrid.setIRBackgroundTail(backgroundTail);
+        appliedBackgroundTail = backgroundTail;
+    }
+    const bool hybridTail = parameters.irHybridTail->get();
+    if (hybridTail != appliedHybridTail) {
+        hybrid.setIRHybridTail(hybridTail);
+        appliedHybridTail = hybridTail;
+    }
+    setLatencySamples(hybrid.getLatencySamples());
+}
+
+void AmbiGlassConvoVerbAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    // May run on the audio thread (automation); preloadMode() never blocks
+    if (parameterID == "mode")
+        hybrid.preloadMode((ReverbMode) juce::roundToInt(newValue));
 }
 
 void AmbiGlassConvoVerbAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
 {
     juce::ScopedNoDenormals _noDenormals;
     const auto numSamples = buffer.getNumSamples();
+    
+    // Asleep: nothing comes in and nothing is left ringing, so the output is silence
+    const bool inputSilent = HybridVerb::getPeak(buffer) <= HybridVerb::silenceThreshold;
+    if (asleep.load(std::memory_order_relaxed) && inputSilent) {
+        buffer.clear();
+        updateActivity(false, numSamples);
+        return;
+    }
+    asleep.store(false, std::memory_order_relaxed);
+    updateActivity(true, numSamples);
+
+    // The chain runs in chunks, so glides advance in small steps whatever the host block size
+    const int chunkSize = subBlockSize.load(std::memory_order_relaxed) > 0 ? subBlockSize.load(std::memory_order_relaxed) : numSamples;
+    for (int start = 0; start < numSamples; start += chunkSize) {
+        juce::AudioBuffer<float> chunk (buffer.getArrayOfWritePointers(), buffer.getNumChannels(),
+                                        start, juce::jmin(chunkSize, numSamples - start));
+        processChunk(chunk);
+    }
+
+    // Latency follows the active mode; the host is told from the message thread
+    if (hybrid.getLatencySamples() != getLatencySamples() || parameters.irLowLatency->get() != appliedLowLatency
+        || parameters.irBackgroundTail->get() != appliedBackgroundTail
+        || parameters.irHybridTail->get() != appliedHybridTail)
+        triggerAsyncUpdate();
 
-    dryBuffer.makeCopyOf(buffer);
+    // Fall asleep once the engine's tail is gone (which covers the dry delay too)
+    // and the rest of the chain has rung out
+    quietOutputSamples = HybridVerb::getPeak(buffer) <= HybridVerb::silenceThreshold ? quietOutputSamples + numSamples : 0;
+    if (inputSilent && hybrid.isTailSilent() && quietOutputSamples >= (int) (chainSettleSeconds * getSampleRate()))
+        asleep.store(true, std::memory_order_relaxed);
+}
+
+void AmbiGlassConvoVerbAudioProcessor::processChunk (juce::AudioBuffer<float>& buffer)
+{
+    const auto numSamples = buffer.getNumSamples();
+    for (int ch = 0; ch < dryBuffer.getNumChannels(); ++ch)
+        dryBuffer.copyFrom(ch, 0, buffer, juce::jmin(ch, buffer.getNumChannels() - 1), 0, numSamples);
 
     juce::dsp::AudioBlock<float> block (buffer);
     juce::dsp::ProcessContextReplacing<float> ctx (block);
 
-    *hpFilter.state = *juce::dsp::IIR::Coefficients<float>::makeHighPass (getSampleRate(), parameters.hpHz->get());
-    *lpFilter.state = *juce::dsp::IIR::Coefficients<float>::makeLowPass  (getSampleRate(), parameters.lpHz->get());
+    if (parameters.consumeChange(Parameters::Group::inputFilters, seenFilterChanges)) {
+        hpCutoff.setTargetValue(parameters.hpHz->get());
+        lpCutoff.setTargetValue(parameters.lpHz->get());
+    }
+    if (hpCutoff.isSmoothing() || lpCutoff.isSmoothing()) {
+        hpCutoff.skip(numSamples);
+        lpCutoff.skip(numSamples);
+        updateInputFilters();
+    }
 
     hpFilter.process(ctx);
     lpFilter.process(ctx);
@@ -51,31 +160,111 @@ void AmbiGlassConvoVerbAudioProcessor::processBlock (juce::AudioBuffer<float>& b
     diffuser.setAmount(parameters.diffusion->get());
     diffuser.process(buffer);
 
-    EngineParams p;
-    p.timeScale   = parameters.rtScale->get();
-    p.width       = parameters.width->get();
-    p.depth       = parameters.depth->get();
-    p.modDepth    = parameters.modDepth->get();
-    p.modRateHz   = parameters.modRate->get();
     hybrid.setMode((ReverbMode) parameters.mode->getIndex());
-    hybrid.setParams(p);
+    if (parameters.consumeChange(Parameters::Group::engine, seenEngineChanges))
+        engineParams.setTarget(getEngineParams());
+    if (engineParams.isSmoothing())
+        hybrid.setParams(engineParams.next(numSamples));
     hybrid.process(buffer);
 
-    modTail.setRate(parameters.modRate->get());
+    const int latency = hybrid.getLatencySamples();
+    dryDelay.setDelay((float) latency);
+    auto dryBlock = juce::dsp::AudioBlock<float> (dryBuffer).getSubBlock(0, (size_t) numSamples);
+    juce::dsp::ProcessContextReplacing<float> dryCtx (dryBlock);
+    dryDelay.process(dryCtx);
+
+    // Same LFO block as the engines just used
     modTail.setDepth(parameters.modDepth->get());
-    modTail.process(buffer);
+    modTail.process(buffer, hybrid.getModulation());
 
-    outputEQ.setGains(parameters.eqLoGain->get(), parameters.eqMidGain->get(), parameters.eqHiGain->get());
+    if (parameters.consumeChange(Parameters::Group::outputEQ, seenEQChanges))
+        outputEQ.setGains(parameters.eqLoGain->get(), parameters.eqMidGain->get(), parameters.eqHiGain->get());
     outputEQ.process(buffer);
 
     msWidth.setWidth(parameters.width->get());
     msWidth.process(buffer);
 
-    const float mix = parameters.dryWet->get() * 0.01f;
-    buffer.applyGain (mix);
-    dryBuffer.applyGain (std::sqrt (1.0f - (mix * mix)));
-    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
-        buffer.addFrom (ch, 0, dryBuffer, ch, 0, numSamples);
+    // Equal-power dry/wet, gliding per sample
+    dryWet.setTargetValue(parameters.dryWet->get() * 0.01f);
+    if (!dryWet.isSmoothing()) {
+        const float mix = dryWet.getTargetValue();
+        buffer.applyGain (mix);
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            buffer.addFrom (ch, 0, dryBuffer, ch, 0, numSamples, std::sqrt (1.0f - (mix * mix)));
+        return;
+    }
+    for (int i = 0; i < numSamples; ++i) {
+        const float mix = dryWet.getNextValue();
+        const float dryGain = std::sqrt (1.0f - (mix * mix));
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+            float* wet = buffer.getWritePointer(ch);
+            wet[i] = wet[i] * mix + dryBuffer.getSample(ch, i) * dryGain;
+        }
+    }
+}
+
+void AmbiGlassConvoVerbAudioProcessor::SmoothedEngineParams::reset(double sampleRate, const EngineParams& p)
+{
+    for (auto* value : { &timeScale, &width, &depth, &diffusion, &modDepth, &modRateHz })
+        value->reset(sampleRate, smoothingSeconds);
+    setTarget(p);
+    for (auto* value : { &timeScale, &width, &depth, &diffusion, &modDepth, &modRateHz })
+        value->setCurrentAndTargetValue(value->getTargetValue());
+}
+
+void AmbiGlassConvoVerbAudioProcessor::SmoothedEngineParams::setTarget(const EngineParams& p)
+{
+    timeScale.setTargetValue(p.timeScale);
+    width.setTargetValue(p.width);
+    depth.setTargetValue(p.depth);
+    diffusion.setTargetValue(p.diffusion);
+    modDepth.setTargetValue(p.modDepth);
+    modRateHz.setTargetValue(p.modRateHz);
+}
+
+bool AmbiGlassConvoVerbAudioProcessor::SmoothedEngineParams::isSmoothing() const
+{
+    return timeScale.isSmoothing() || width.isSmoothing() || depth.isSmoothing()
+        || diffusion.isSmoothing() || modDepth.isSmoothing() || modRateHz.isSmoothing();
+}
+
+EngineParams AmbiGlassConvoVerbAudioProcessor::SmoothedEngineParams::next(int numSamples)
+{
+    EngineParams p;
+    p.timeScale = timeScale.skip(numSamples);
+    p.width = width.skip(numSamples);
+    p.depth = depth.skip(numSamples);
+    p.diffusion = diffusion.skip(numSamples);
+    p.modDepth = modDepth.skip(numSamples);
+    p.modRateHz = modRateHz.skip(numSamples);
+    return p;
+}
+
+void AmbiGlassConvoVerbAudioProcessor::updateInputFilters()
+{
+    using Coefficients = juce::dsp::IIR::ArrayCoefficients<float>;
+    *hpFilter.state = Coefficients::makeHighPass (getSampleRate(), hpCutoff.getCurrentValue());
+    *lpFilter.state = Coefficients::makeLowPass  (getSampleRate(), lpCutoff.getCurrentValue());
+}
+
+EngineParams AmbiGlassConvoVerbAudioProcessor::getEngineParams() const
+{
+    EngineParams p;
+    p.timeScale   = parameters.rtScale->get();
+    p.width       = parameters.width->get();
+    p.depth       = parameters.depth->get();
+    p.diffusion   = parameters.diffusion->get();
+    p.modDepth    = parameters.modDepth->get();
+    p.modRateHz   = parameters.modRate->get();
+    return p;
+}
+
+void AmbiGlassConvoVerbAudioProcessor::updateActivity(bool processed, int numSamples)
+{
+    // One-pole average over about a second of audio
+    const float coefficient = juce::jmin(1.0f, (float) numSamples / (float) getSampleRate());
+    const float current = activity.load(std::memory_order_relaxed);
+    activity.store(current + ((processed ? 1.0f : 0.0f) - current) * coefficient, std::memory_order_relaxed);
 }
 
 void AmbiGlassConvoVerbAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
@@ -164,9 +353,17 @@ bool AmbiGlassConvoVerbAudioProcessor::loadIR(const juce::File& file)
     return false;
 }
 
+bool AmbiGlassConvoVerbAudioProcessor::loadIRNow(const juce::File& file)
+{
+    if (!hybrid.loadIRNow(file))
+        return false;
+    currentIRPath = file.getFullPathName();
+    dryDelay.setDelay((float) hybrid.getLatencySamples());
+    setLatencySamples(hybrid.getLatencySamples());
+    return true;
+}
+
 juce::String AmbiGlassConvoVerbAudioProcessor::getIRInfo() const
 {
-    // This would need to be exposed through HybridVerb
-    // For now, return empty string
-    return "";
+    return hybrid.getIRInfo();
 }
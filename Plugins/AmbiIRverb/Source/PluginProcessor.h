@@ -9,11 +9,13 @@
 #include "FileIO.h"
 #include "LookAndFeel.h"
 
-class AmbiGlassConvoVerbAudioProcessor : public juce::AudioProcessor
+class AmbiGlassConvoVerbAudioProcessor : public juce::AudioProcessor,
+                                         private juce::AsyncUpdater,
+                                         private juce::AudioProcessorValueTreeState::Listener
 {
 public:
     AmbiGlassConvoVerbAudioProcessor();
-    ~AmbiGlassConvoVerbAudioProcessor() override = default;
+    ~AmbiGlassConvoVerbAudioProcessor() override;
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override {}
@@ -29,7 +31,9 @@ public:
     bool acceptsMidi() const override { return false; }
     bool producesMidi() const override { return false; }
     bool isMidiEffect() const override { return false; }
-    double getTailLengthSeconds() const override { return 10.0; }
+    // Follows the playing mode and its settings (IR length, Time, diffusion), so a
+    // bounce renders the tail down to -60 dB and no further
+    double getTailLengthSeconds() const override { return hybrid.getTailSeconds() + chainSettleSeconds; }
 
     int getNumPrograms() override { return 1; }
     int getCurrentProgram() override { return 0; }
@@ -44,17 +48,75 @@ public:
     bool loadPreset(const juce::File& file);
     bool savePreset(const juce::File& file);
     bool loadIR(const juce::File& file);
+    // Offline rendering: builds the IR before returning and updates the latency.
+    // Call between prepareToPlay() and processing, never while the host is playing.
+    bool loadIRNow(const juce::File& file);
     juce::String getIRInfo() const;
+    // Delay memory this instance allocated for the algorithmic engines
+    size_t getDelayMemoryBytes() const { return hybrid.getDelayMemoryBytes(); }
+    // Sleep meter: whether the chain is skipped right now, and the share of blocks
+    // over roughly the last second that were processed (1 = always awake)
+    bool isAsleep() const { return asleep.load(std::memory_order_relaxed); }
+    float getActivity() const { return activity.load(std::memory_order_relaxed); }
+    
+    // processBlock runs the chain in chunks of this many samples, so parameter glides
+    // and coefficient updates stay fine-grained at large host buffers; 0 processes
+    // each host block in one go
+    static constexpr int defaultSubBlockSize = 32;
+    void setSubBlockSize(int numSamples) { subBlockSize = juce::jmax(0, numSamples); }
 
     Parameters parameters;
 private:
-    juce::dsp::IIR::Filter<float> hpFilter, lpFilter;
+    // Applies the IR latency mode and reports latency to the host (message thread)
+    void handleAsyncUpdate() override;
+    // Mode changes start building the new engine before the audio thread switches
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+
+    // Input filters; cutoff changes glide, with coefficients recomputed in place
+    // (no allocation) once per block only while they do
+    using StereoFilter = juce::dsp::ProcessorDuplicator<juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Coefficients<float>>;
+    void updateInputFilters();
+    EngineParams getEngineParams() const;
+    void processChunk(juce::AudioBuffer<float>& chunk);
+    StereoFilter hpFilter, lpFilter;
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> hpCutoff, lpCutoff;
+    // Continuous parameters glide over smoothingSeconds: per sample in the mix, width,
+    // diffuser and ModTail stages, per chunk for filter coefficients and the engine
+    static constexpr double smoothingSeconds = 0.05;
+    juce::SmoothedValue<float> dryWet;
+    struct SmoothedEngineParams
+    {
+        juce::SmoothedValue<float> timeScale, width, depth, diffusion, modDepth, modRateHz;
+        // Jumps to p
+        void reset(double sampleRate, const EngineParams& p);
+        void setTarget(const EngineParams& p);
+        bool isSmoothing() const;
+        // Advances numSamples and returns the values reached
+        EngineParams next(int numSamples);
+    };
+    SmoothedEngineParams engineParams;
+    std::atomic<int> subBlockSize { defaultSubBlockSize };
+    // Parameters::consumeChange() counts per group
+    juce::uint32 seenFilterChanges = 0, seenEngineChanges = 0, seenEQChanges = 0;
     Diffuser diffuser;
     HybridVerb hybrid;
     ModTail modTail;
     OutputEQ outputEQ;
     MsWidth msWidth;
     juce::AudioBuffer<float> dryBuffer;
+    // Keeps the dry path aligned with the reported (IR) latency
+    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::None> dryDelay;
+    std::atomic<bool> appliedLowLatency { false };
+    std::atomic<bool> appliedBackgroundTail { false };
+    std::atomic<bool> appliedHybridTail { false };
+    
+    // Sleep mode: while the input is silent and every tail has decayed, processBlock
+    // outputs silence without running the chain, until the input returns
+    static constexpr double chainSettleSeconds = 0.05;  // Filters, ModTail and EQ ring-out
+    void updateActivity(bool processed, int numSamples);
+    int quietOutputSamples = 0;
+    std::atomic<bool> asleep { false };
+    std::atomic<float> activity { 1.0f };
     LiquidGlassLookAndFeel lookAndFeel;
     
     juce::String currentIRPath;  // Store current IR path for preset saving
@@ -1,41 +1,57 @@
 #include "RoomEngine.h"
+#include <numeric>
 #include <cmath>
 
 RoomEngine::RoomEngine()
 {
     params.timeScale = 1.0f;
-    params.diffusion = 0.5f;
+    params.diffusion = 50.0f;
     params.width = 1.0f;
     params.depth = 50.0f;  // Default: balanced early/late
     params.modDepth = 0.0f;
-    params.modRate = 0.3f;
-    
-    // Initialize simple mixing matrix for late reverb (4x4)
-    // Use a simple orthogonal matrix
-    mixingMatrix[0] = { 0.5f,  0.5f,  0.5f,  0.5f };
-    mixingMatrix[1] = { 0.5f, -0.5f,  0.5f, -0.5f };
-    mixingMatrix[2] = { 0.5f,  0.5f, -0.5f, -0.5f };
-    mixingMatrix[3] = { 0.5f, -0.5f, -0.5f,  0.5f };
+    params.modRateHz = 0.3f;
+    
+    initializeStereoVectors();
+    
+    // Line offsets spread evenly round the circle
+    for (int i = 0; i < numLateLines; ++i)
+        modOffsets[static_cast<size_t>(i)] = LfoBank::PhaseOffset::fromTurns(static_cast<double>(i) / numLateLines);
 }
 
-void RoomEngine::prepare(const juce::dsp::ProcessSpec& spec)
+size_t RoomEngine::getDelayMemorySize(const juce::dsp::ProcessSpec& spec)
 {
-    sampleRate = spec.sampleRate;
-    
-    // Initialize early reflections
-    initializeEarlyReflections(spec.sampleRate, roomSizeMs);
-    
-    // Prepare late reverb delays (4-line FDN)
-    int maxDelaySamples = static_cast<int>(spec.sampleRate * 0.3);  // 300ms max
-    int bufferSize = maxDelaySamples * 2;
+    DelayArena::Region counter;
+    layoutDelays(spec, counter);
+    return counter.getUsed();
+}
+
+void RoomEngine::layoutDelays(const juce::dsp::ProcessSpec& spec, DelayArena::Region& memory)
+{
+    // Early reflections: the last tap is at 0.8 x room size, read in spans of up to a block
+    const int maxBlock = static_cast<int>(spec.maximumBlockSize);
+    maxEarlyDelaySamples = static_cast<int>(std::ceil(baseRoomSizeMs * 0.8f * EngineLimits::maxTimeScale
+                                                      * spec.sampleRate / 1000.0));
+    for (auto& line : earlyLines)
+        line.prepare(maxEarlyDelaySamples + maxBlock, maxBlock, memory);
     
+    // Late reverb delays (4-line FDN)
     // Base delays in ms (shorter than plate for room character)
     std::array<int, numLateLines> delayMs = { 100, 147, 199, 251 };
     
     for (size_t i = 0; i < lateDelays.size(); ++i) {
         baseLateDelays[i] = static_cast<int>(delayMs[i] * spec.sampleRate / 1000.0);
-        lateDelays[i].prepare(baseLateDelays[i], bufferSize);
+        lateDelays[i].prepare(EngineLimits::getMaxDelaySamples(baseLateDelays[i]), 0, memory);
     }
+}
+
+void RoomEngine::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    sampleRate = spec.sampleRate;
+    
+    auto memory = ownDelayMemory.assignedOrOwn(delayMemory, getDelayMemorySize(spec));
+    layoutDelays(spec, memory);
+    earlySum.assign(spec.maximumBlockSize, 0.0f);
+    initializeEarlyReflections(spec.sampleRate, roomSizeMs);
     
     reset();
     updateParameters();
@@ -43,24 +59,18 @@ void RoomEngine::prepare(const juce::dsp::ProcessSpec& spec)
 
 void RoomEngine::reset()
 {
-    for (auto& early : earlyReflections) {
-        std::fill(early.delayLine.begin(), early.delayLine.end(), 0.0f);
-        early.writePos = 0;
-    }
+    for (auto& line : earlyLines)
+        line.reset();
     
-    for (auto& delay : lateDelays) {
-        std::fill(delay.buffer.begin(), delay.buffer.end(), 0.0f);
-        delay.writePos = 0;
-    }
-    
-    modPhase = 0.0f;
+    for (auto& delay : lateDelays)
+        delay.reset();
 }
 
 void RoomEngine::initializeEarlyReflections(double sampleRate, float roomSize)
 {
     // Generate early reflection pattern
     // Typical room: initial reflections at 5-20ms, then decaying taps
-    int maxDelaySamples = static_cast<int>(sampleRate * 0.1);  // 100ms max for early
+    // Only sets the taps, so it is safe to call from setParams()
     
     // Early reflection pattern (delays in ms, gains, panning)
     struct EarlyPattern {
@@ -81,12 +91,27 @@ void RoomEngine::initializeEarlyReflections(double sampleRate, float roomSize)
     };
     
     for (size_t i = 0; i < earlyReflections.size(); ++i) {
-        earlyReflections[i].prepare(pattern[i].delayMs, sampleRate, maxDelaySamples);
+        earlyReflections[i].delaySamples = juce::jlimit(1, maxEarlyDelaySamples,
+            static_cast<int>(pattern[i].delayMs * sampleRate / 1000.0));
         earlyReflections[i].gain = pattern[i].gain;
         earlyReflections[i].pan = pattern[i].pan;
     }
 }
 
+void RoomEngine::initializeStereoVectors()
+{
+    // Walsh-Hadamard rows: entry (row, i) is -1 when row & i has odd parity. Row 0
+    // (all ones) would treat both sides alike, so it is not used.
+    auto hadamardRow = [](int row) {
+        std::array<float, numLateLines> v;
+        for (int i = 0; i < numLateLines; ++i)
+            v[static_cast<size_t>(i)] = (juce::countNumberOfBits(static_cast<juce::uint32>(row & i)) & 1) ? -1.0f : 1.0f;
+        return v;
+    };
+    inputGains = { hadamardRow(1), hadamardRow(2) };
+    outputTaps = { hadamardRow(numLateLines - 1), hadamardRow(numLateLines / 2 - 1) };
+}
+
 void RoomEngine::updateParameters()
 {
     // Map diffusion to feedback gain (0.5-0.85)
@@ -94,26 +119,30 @@ void RoomEngine::updateParameters()
     feedbackGain = juce::jlimit(0.5f, 0.85f, feedbackGain);
     
     // Update room size based on timeScale
-    roomSizeMs = 20.0f * params.timeScale;
+    roomSizeMs = baseRoomSizeMs * params.timeScale;
     initializeEarlyReflections(sampleRate, roomSizeMs);
 }
 
 void RoomEngine::processEarlyReflections(juce::AudioBuffer<float>& buffer, float gain)
 {
     const int numSamples = buffer.getNumSamples();
-    const int numChannels = buffer.getNumChannels();
+    const int numChannels = juce::jmin(buffer.getNumChannels(), static_cast<int>(earlyLines.size()));
+    const int maxBlock = static_cast<int>(earlySum.size());
+    if (maxBlock == 0) return;  // Not prepared yet
     
-    for (int sample = 0; sample < numSamples; ++sample) {
-        for (int ch = 0; ch < numChannels; ++ch) {
-            float* channelData = buffer.getWritePointer(ch);
-            float input = channelData[sample];
+    for (int ch = 0; ch < numChannels; ++ch) {
+        float* channelData = buffer.getWritePointer(ch);
+        auto& line = earlyLines[static_cast<size_t>(ch)];
+        
+        for (int start = 0; start < numSamples; start += maxBlock) {
+            const int blockSize = juce::jmin(maxBlock, numSamples - start);
+            float* block = channelData + start;
             
-            float earlySum = 0.0f;
+            // Write the block first, so even taps shorter than the block read one span
+            line.writeBlock(block, blockSize);
+            std::fill(earlySum.begin(), earlySum.begin() + blockSize, 0.0f);
             
-            // Process each early reflection
-            for (auto& early : earlyReflections) {
-                float reflection = early.read();
-                
+            for (const auto& early : earlyReflections) {
                 // Apply panning (simple stereo spread)
                 float panFactor = 1.0f;
                 if (numChannels == 2) {
@@ -124,12 +153,15 @@ void RoomEngine::processEarlyReflections(juce::AudioBuffer<float>& buffer, float
                     }
                 }
                 
-                earlySum += reflection * early.gain * panFactor;
-                early.write(input);
+                const float tapGain = early.gain * panFactor;
+                const float* reflection = line.readSpan(early.delaySamples + blockSize, blockSize);
+                for (int sample = 0; sample < blockSize; ++sample)
+                    earlySum[static_cast<size_t>(sample)] += reflection[sample] * tapGain;
             }
             
             // Mix early reflections
-            channelData[sample] = input + earlySum * gain;
+            for (int sample = 0; sample < blockSize; ++sample)
+                block[sample] += earlySum[static_cast<size_t>(sample)] * gain;
         }
     }
 }
@@ -138,56 +170,57 @@ void RoomEngine::processLateReverb(juce::AudioBuffer<float>& buffer, float gain)
 {
     const int numSamples = buffer.getNumSamples();
     const int numChannels = buffer.getNumChannels();
+    float* left = buffer.getWritePointer(0);
+    float* right = numChannels > 1 ? buffer.getWritePointer(1) : nullptr;
+    
+    // Modulation from the shared LFO (none without one for this block)
+    const bool modulated = lfo != nullptr && lfo->getNumSamples() >= numSamples && params.modDepth > 0.01f;
+    const float modAmount = modulated ? params.modDepth * 0.0001f : 0.0f;
+    const float* modSine = modulated ? lfo->getSine() : nullptr;
+    const float* modCosine = modulated ? lfo->getCosine() : nullptr;
     
-    // Calculate modulation
-    const float modIncrement = 2.0f * juce::MathConstants<float>::pi * params.modRateHz / static_cast<float>(sampleRate);
-    float modAmount = params.modDepth * 0.0001f;
+    // Fractional delays never go below the interpolator's first tap
+    constexpr float minDelay = 2.0f;
     
+    // One network step per stereo frame
     for (int sample = 0; sample < numSamples; ++sample) {
-        // Calculate modulation
-        float mod = 1.0f;
-        if (params.modDepth > 0.01f) {
-            mod = 1.0f + std::sin(modPhase) * modAmount;
-            modPhase += modIncrement;
-            if (modPhase > 2.0f * juce::MathConstants<float>::pi) {
-                modPhase -= 2.0f * juce::MathConstants<float>::pi;
-            }
+        const float modSin = modulated ? modSine[sample] : 0.0f;
+        const float modCos = modulated ? modCosine[sample] : 0.0f;
+        
+        const float inL = left[sample];
+        const float inR = right != nullptr ? right[sample] : inL;
+        
+        // Read from all late delays, each at its own LFO phase, interpolated
+        std::array<float, numLateLines> delayed;
+        for (size_t i = 0; i < lateDelays.size(); ++i) {
+            const float mod = 1.0f + modOffsets[i].apply(modSin, modCos) * modAmount;
+            const float delaySamples = juce::jlimit(minDelay, static_cast<float>(lateDelays[i].getMaxDelay() - 2),
+                                                    baseLateDelays[i] * params.timeScale * mod);
+            delayed[i] = lateDelays[i].readFractional<DelayInterpolation::lagrange3>(delaySamples);
         }
         
-        for (int ch = 0; ch < numChannels; ++ch) {
-            float* channelData = buffer.getWritePointer(ch);
-            float input = channelData[sample];
-            
-            // Read from all late delays
-            std::array<float, numLateLines> delayed;
-            for (size_t i = 0; i < lateDelays.size(); ++i) {
-                int delaySamples = static_cast<int>(baseLateDelays[i] * params.timeScale * mod);
-                delaySamples = juce::jlimit(1, static_cast<int>(lateDelays[i].buffer.size()) - 1, delaySamples);
-                delayed[i] = lateDelays[i].read(delaySamples);
-            }
-            
-            // Mix through matrix
-            std::array<float, numLateLines> mixed;
-            for (int i = 0; i < numLateLines; ++i) {
-                mixed[i] = 0.0f;
-                for (int j = 0; j < numLateLines; ++j) {
-                    mixed[i] += mixingMatrix[i][j] * delayed[j];
-                }
-            }
-            
-            // Sum output
-            float output = 0.0f;
-            for (int i = 0; i < numLateLines; ++i) {
-                output += mixed[i];
-            }
-            
-            // Write feedback
-            for (size_t i = 0; i < lateDelays.size(); ++i) {
-                lateDelays[i].write(input + mixed[i] * feedbackGain);
-            }
-            
-            // Mix late reverb
-            channelData[sample] += output * gain;
+        // Mix through the normalised 4x4 Hadamard matrix (butterflies)
+        std::array<float, numLateLines> mixed;
+        FDNMixing::Hadamard<numLateLines>::apply(delayed.data(), mixed.data());
+        
+        // Pick up L/R through their tap vectors
+        float outL = 0.0f, outR = 0.0f;
+        for (size_t i = 0; i < mixed.size(); ++i) {
+            outL += outputTaps[0][i] * mixed[i];
+            outR += outputTaps[1][i] * mixed[i];
+        }
+        
+        // Write feedback, injecting L/R through their gain vectors
+        for (size_t i = 0; i < lateDelays.size(); ++i) {
+            lateDelays[i].push(inputGains[0][i] * inL + inputGains[1][i] * inR + mixed[i] * feedbackGain);
+        }
+        
+        // Mix late reverb
+        if (right != nullptr) {
+            left[sample] += outL * gain;
+            right[sample] += outR * gain;
+        } else {
+            left[sample] += 0.5f * (outL + outR) * gain;
         }
     }
 }
@@ -205,3 +238,22 @@ void RoomEngine::process(juce::AudioBuffer<float>& buffer)
     // Process late reverb
     processLateReverb(buffer, lateGain);
 }
+
+double RoomEngine::getMemorySeconds() const
+{
+    // The longest late line (the early taps are shorter) at the current time scale
+    const int longest = *std::max_element(baseLateDelays.begin(), baseLateDelays.end());
+    return longest * params.timeScale * (1.0f + EngineLimits::maxModulation) / sampleRate;
+}
+
+double RoomEngine::getDecaySeconds() const
+{
+    // The late network (Hadamard mix, one gain per pass over the mean line) usually
+    // outlasts the last early reflection
+    const double mean = std::accumulate(baseLateDelays.begin(), baseLateDelays.end(), 0.0) / numLateLines;
+    const double late = getLoopDecaySeconds(mean * params.timeScale / sampleRate, feedbackGain);
+    int lastEarly = 0;
+    for (const auto& early : earlyReflections)
+        lastEarly = juce::jmax(lastEarly, early.delaySamples);
+    return juce::jmax(late, lastEarly / sampleRate);
+}
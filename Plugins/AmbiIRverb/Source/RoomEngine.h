@@ -1,85 +1,67 @@
 #pragma once
 #include "HybridVerb.h"
+#include "FDNMixing.h"
+#include "MaskedDelayLine.h"
 #include <JuceHeader.h>
 
 class RoomEngine : public IReverbEngine {
 public:
     RoomEngine();
+    size_t getDelayMemorySize(const juce::dsp::ProcessSpec& spec) override;
+    void setDelayMemory(DelayArena::Region memory) override { delayMemory = memory; }
+    void setModulation(const LfoBank* bank) override { lfo = bank; }
     void prepare(const juce::dsp::ProcessSpec& spec) override;
     void reset() override;
     void setParams(const EngineParams& p) override { params = p; updateParameters(); }
     void process(juce::AudioBuffer<float>& buffer) override;
+    double getMemorySeconds() const override;
+    double getDecaySeconds() const override;
 
 private:
+    // A tap on the per-channel early reflection lines
     struct EarlyReflection {
-        std::vector<float> delayLine;
-        int writePos = 0;
-        int delaySamples = 0;
+        int delaySamples = 1;
         float gain = 1.0f;
         float pan = 0.0f;  // -1.0 (left) to 1.0 (right)
-        
-        void prepare(int delayMs, double sampleRate, int maxSize) {
-            delaySamples = static_cast<int>(delayMs * sampleRate / 1000.0);
-            delayLine.resize(maxSize);
-            std::fill(delayLine.begin(), delayLine.end(), 0.0f);
-            writePos = 0;
-        }
-        
-        float read() const {
-            int readPos = (writePos - delaySamples + static_cast<int>(delayLine.size())) % static_cast<int>(delayLine.size());
-            return delayLine[readPos];
-        }
-        
-        void write(float sample) {
-            delayLine[writePos] = sample;
-            writePos = (writePos + 1) % static_cast<int>(delayLine.size());
-        }
-    };
-    
-    struct DelayLine {
-        std::vector<float> buffer;
-        int writePos = 0;
-        int baseDelaySamples = 0;
-        
-        void prepare(int delaySamples, int maxSize) {
-            baseDelaySamples = delaySamples;
-            buffer.resize(maxSize);
-            std::fill(buffer.begin(), buffer.end(), 0.0f);
-            writePos = 0;
-        }
-        
-        float read(int delaySamples) const {
-            int readPos = (writePos - delaySamples + static_cast<int>(buffer.size())) % static_cast<int>(buffer.size());
-            return buffer[readPos];
-        }
-        
-        void write(float sample) {
-            buffer[writePos] = sample;
-            writePos = (writePos + 1) % static_cast<int>(buffer.size());
-        }
     };
     
+    // Places the delay lines in `memory` (or only counts, for getDelayMemorySize())
+    void layoutDelays(const juce::dsp::ProcessSpec& spec, DelayArena::Region& memory);
     void initializeEarlyReflections(double sampleRate, float roomSize);
+    void initializeStereoVectors();
     void updateParameters();
     void processEarlyReflections(juce::AudioBuffer<float>& buffer, float gain);
     void processLateReverb(juce::AudioBuffer<float>& buffer, float gain);
     
     EngineParams params;
     double sampleRate = 48000.0;
+    DelayArena::Region delayMemory;
+    DelayArena ownDelayMemory;  // Only when no region was set
+    const LfoBank* lfo = nullptr;
     
     // Early reflections
     static constexpr int numEarlyReflections = 8;
     std::array<EarlyReflection, numEarlyReflections> earlyReflections;
-    float roomSizeMs = 20.0f;  // Base room size in ms
+    // One multi-tap line per channel; blocks are written whole, then each tap is read as a span
+    std::array<MaskedDelayLine<float>, 2> earlyLines;
+    std::vector<float> earlySum;  // maximumBlockSize
+    static constexpr float baseRoomSizeMs = 20.0f;
+    float roomSizeMs = baseRoomSizeMs;  // Scaled by Time
+    int maxEarlyDelaySamples = 1;
     
     // Late reverb (4-line FDN)
     static constexpr int numLateLines = 4;
-    std::array<DelayLine, numLateLines> lateDelays;
-    std::array<int, numLateLines> baseLateDelays;
+    std::array<MaskedDelayLine<float>, numLateLines> lateDelays;
+    std::array<int, numLateLines> baseLateDelays {};
     
-    // Mixing matrix for late reverb (simple Hadamard-like)
-    std::array<std::array<float, numLateLines>, numLateLines> mixingMatrix;
+
+    // Stereo injection and pick-up: L and R enter and leave the network through
+    // different Walsh-Hadamard sign patterns, so the outputs are decorrelated
+    std::array<std::array<float, numLateLines>, 2> inputGains;
+    std::array<std::array<float, numLateLines>, 2> outputTaps;
     
     float feedbackGain = 0.7f;
-    float modPhase = 0.0f;
+    
+    // Each late line follows the shared LFO at its own phase, spread evenly
+    std::array<LfoBank::PhaseOffset, numLateLines> modOffsets;
 };
@@ -0,0 +1,110 @@
+#include "SharedIRStore.h"
+
+namespace {
+    using Spectra = std::shared_ptr<const PreparedSpectra>;
+    
+    struct Store {
+        juce::CriticalSection lock;   // Only held for map updates, never across a load or build
+        std::map<juce::String, std::weak_ptr<const PreparedSpectra>> entries;
+        std::map<juce::String, std::shared_future<Spectra>> inFlight;
+    };
+    
+    Store& getStore()
+    {
+        static Store store;
+        return store;
+    }
+    
+    // Cache, else build (and write the cache); nullptr if that failed or was abandoned
+    Spectra loadOrBuild(const juce::String& key, const SharedIRStore::Builder& build)
+    {
+        if (auto cached = IRSpectraCache::load(key))
+            return cached;
+        
+        auto built = build();
+        if (built == nullptr) return nullptr;
+        
+        auto prepared = std::make_shared<PreparedSpectra>();
+        juce::MemoryOutputStream out(prepared->memory, false);
+        built->writeSpectra(out);
+        out.flush();
+        IRSpectraCache::store(key, *prepared);
+        return prepared;
+    }
+}
+
+std::shared_ptr<const PreparedSpectra> SharedIRStore::acquire(const juce::String& key, const Builder& build)
+{
+    auto& store = getStore();
+    
+    for (;;) {
+        std::promise<Spectra> promise;
+        std::shared_future<Spectra> building;
+        {
+            const juce::ScopedLock sl(store.lock);
+            for (auto it = store.entries.begin(); it != store.entries.end();) {
+                if (it->second.expired()) it = store.entries.erase(it);
+                else ++it;
+            }
+            
+            const auto it = store.entries.find(key);
+            if (it != store.entries.end())
+                if (auto resident = it->second.lock())
+                    return resident;
+            
+            const auto pending = store.inFlight.find(key);
+            if (pending == store.inFlight.end()) {
+                // This thread loads it; others asking for the same key wait for the result
+                store.inFlight[key] = promise.get_future().share();
+            } else {
+                building = pending->second;
+            }
+        }
+        
+        if (!building.valid()) {
+            Spectra spectra;
+            try {
+                spectra = loadOrBuild(key, build);
+            } catch (...) {
+                const juce::ScopedLock sl(store.lock);
+                store.inFlight.erase(key);
+                promise.set_value(nullptr);
+                throw;
+            }
+            {
+                const juce::ScopedLock sl(store.lock);
+                if (spectra != nullptr)
+                    store.entries[key] = spectra;
+                store.inFlight.erase(key);
+            }
+            promise.set_value(spectra);
+            return spectra;
+        }
+        
+        // Waiting stays interruptible, so a loader thread asked to exit can leave
+        while (building.wait_for(std::chrono::milliseconds(20)) != std::future_status::ready)
+            if (juce::Thread::currentThreadShouldExit())
+                return nullptr;
+        if (auto spectra = building.get())
+            return spectra;
+        // The other load failed or was abandoned: try again, building here if need be
+    }
+}
+
+void SharedIRStore::discard(const juce::String& key)
+{
+    auto& store = getStore();
+    const juce::ScopedLock sl(store.lock);
+    store.entries.erase(key);
+    IRSpectraCache::remove(key);
+}
+
+int SharedIRStore::getNumResident()
+{
+    auto& store = getStore();
+    const juce::ScopedLock sl(store.lock);
+    int count = 0;
+    for (const auto& entry : store.entries)
+        if (!entry.second.expired()) ++count;
+    return count;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <JuceHeader.h>
+#include "IRSpectraCache.h"
+#include <future>
+
+// Process-wide store of prepared IR spectra, keyed like IRSpectraCache (content hash,
+// sample rate, layout, stretch). Every plugin instance that loads the same IR shares
+// one read-only copy; entries live as long as some convolver holds them.
+// Lookups go: resident in this process -> mapped from the disk cache -> built.
+class SharedIRStore {
+public:
+    using Builder = std::function<std::unique_ptr<PartitionedConvolver>()>;
+    
+    // Returns the spectra for key, calling build() (and writing the result to the disk
+    // cache) only if neither this process nor the cache has them. Resident spectra come
+    // back at once; concurrent requests for a key being loaded wait for that one load.
+    // build() may return nullptr to give up. Not real-time safe.
+    static std::shared_ptr<const PreparedSpectra> acquire(const juce::String& key, const Builder& build);
+    // Drops an entry that failed to restore, here and on disk
+    static void discard(const juce::String& key);
+    
+    static int getNumResident();
+};
@@ -4,28 +4,38 @@ SpringEngine::SpringEngine()
 {
     // Initialize with default parameters
     params.timeScale = 1.0f;
-    params.diffusion = 0.35f;
+    params.diffusion = 35.0f;
     params.width = 1.0f;
     params.modDepth = 0.0f;
-    params.modRate = 0.3f;
+    params.modRateHz = 0.3f;
 }
 
-void SpringEngine::prepare(const juce::dsp::ProcessSpec& spec)
+size_t SpringEngine::getDelayMemorySize(const juce::dsp::ProcessSpec& spec)
 {
-    sampleRate = spec.sampleRate;
-    
-    // Calculate max delay needed
-    int maxDelaySamples = static_cast<int>(spec.sampleRate * 0.6);  // 600ms max
-    
-    // Prepare allpass stages
+    DelayArena::Region counter;
+    layoutDelays(spec.sampleRate, counter);
+    return counter.getUsed();
+}
+
+void SpringEngine::layoutDelays(double rate, DelayArena::Region& memory)
+{
+    // Prepare allpass stages (each line only as long as its delay)
     for (size_t i = 0; i < apStages.size(); ++i) {
-        apStages[i].prepare(maxDelaySamples, apDelaysMs[i], spec.sampleRate);
+        apStages[i].prepare(apDelaysMs[i], rate, memory);
     }
     
-    // Prepare delay tanks
+    // Prepare delay tanks (longest time scale plus modulation)
     for (size_t i = 0; i < tanks.size(); ++i) {
-        tanks[i].prepare(tankDelaysMs[i], spec.sampleRate);
+        tanks[i].prepare(tankDelaysMs[i], rate, memory);
     }
+}
+
+void SpringEngine::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    sampleRate = spec.sampleRate;
+    
+    auto memory = ownDelayMemory.assignedOrOwn(delayMemory, getDelayMemorySize(spec));
+    layoutDelays(spec.sampleRate, memory);
     
     reset();
     updateParameters();
@@ -33,18 +43,13 @@ void SpringEngine::prepare(const juce::dsp::ProcessSpec& spec)
 
 void SpringEngine::reset()
 {
-    for (auto& stage : apStages) {
-        std::fill(stage.delayLine.begin(), stage.delayLine.end(), 0.0f);
-        stage.writePos = 0;
-    }
+    for (auto& stage : apStages)
+        stage.delayLine.reset();
     
     for (auto& tank : tanks) {
-        std::fill(tank.delayLine.begin(), tank.delayLine.end(), 0.0f);
-        tank.writePos = 0;
+        tank.delayLine.reset();
         tank.lastSample = 0.0f;
     }
-    
-    modPhase = 0.0f;
 }
 
 void SpringEngine::updateParameters()
@@ -76,19 +81,15 @@ void SpringEngine::process(juce::AudioBuffer<float>& buffer)
     const int numSamples = buffer.getNumSamples();
     const int numChannels = buffer.getNumChannels();
     
-    // Update modulation phase
-    const float modIncrement = 2.0f * juce::MathConstants<float>::pi * params.modRateHz / static_cast<float>(sampleRate);
+    // Modulation from the shared LFO (none without one for this block)
+    const bool modulated = lfo != nullptr && lfo->getNumSamples() >= numSamples && params.modDepth > 0.01f;
+    const float modAmount = modulated ? params.modDepth * 0.0001f : 0.0f;  // Very subtle
     
     for (int sample = 0; sample < numSamples; ++sample) {
-        // Calculate modulation (subtle delay length variation)
-        float mod = 1.0f;
-        if (params.modDepth > 0.01f) {
-            mod = 1.0f + std::sin(modPhase) * params.modDepth * 0.0001f;  // Very subtle
-            modPhase += modIncrement;
-            if (modPhase > 2.0f * juce::MathConstants<float>::pi) {
-                modPhase -= 2.0f * juce::MathConstants<float>::pi;
-            }
-        }
+        // Calculate modulation (subtle delay length variation); the tanks run in
+        // quadrature, so their pitch drifts never coincide
+        const std::array<float, numTanks> mod = { 1.0f + (modulated ? lfo->getSine()[sample] : 0.0f) * modAmount,
+                                                  1.0f + (modulated ? lfo->getCosine()[sample] : 0.0f) * modAmount };
         
         // Process each channel
         for (int ch = 0; ch < numChannels; ++ch) {
@@ -108,7 +109,7 @@ void SpringEngine::process(juce::AudioBuffer<float>& buffer)
             int tankIdx = ch % numTanks;
             
             // Apply time scaling with optional modulation
-            float effectiveTimeScale = params.timeScale * mod;
+            float effectiveTimeScale = params.timeScale * mod[static_cast<size_t>(tankIdx)];
             
             // Process through delay tank
             float tankOutput = tanks[tankIdx].process(apOutput, effectiveTimeScale, 0.3f);
@@ -121,3 +122,28 @@ void SpringEngine::process(juce::AudioBuffer<float>& buffer)
         }
     }
 }
+
+double SpringEngine::getMemorySeconds() const
+{
+    // Through the allpass ladder, then round the longest tank
+    int ladder = 0;
+    for (const auto& stage : apStages)
+        ladder += stage.delayLength;
+    int longestTank = 0;
+    for (const auto& tank : tanks)
+        longestTank = juce::jmax(longestTank, tank.baseDelaySamples);
+    return (ladder + longestTank * params.timeScale * (1.0f + EngineLimits::maxModulation)) / sampleRate;
+}
+
+double SpringEngine::getDecaySeconds() const
+{
+    // The allpass ladder smears the input (each stage rings at its own feedback),
+    // then the tank recirculates it at feedbackGain per round trip
+    double ladder = 0.0;
+    for (const auto& stage : apStages)
+        ladder = juce::jmax(ladder, getLoopDecaySeconds(stage.delayLength / sampleRate, stage.feedback));
+    double tank = 0.0;
+    for (const auto& t : tanks)
+        tank = juce::jmax(tank, getLoopDecaySeconds(t.baseDelaySamples * params.timeScale / sampleRate, t.feedbackGain));
+    return ladder + tank;
+}
@@ -1,35 +1,36 @@
 #pragma once
 #include "HybridVerb.h"
+#include "MaskedDelayLine.h"
 #include <JuceHeader.h>
 
 class SpringEngine : public IReverbEngine {
 public:
     SpringEngine();
+    size_t getDelayMemorySize(const juce::dsp::ProcessSpec& spec) override;
+    void setDelayMemory(DelayArena::Region memory) override { delayMemory = memory; }
+    void setModulation(const LfoBank* bank) override { lfo = bank; }
     void prepare(const juce::dsp::ProcessSpec& spec) override;
     void reset() override;
     void setParams(const EngineParams& p) override { params = p; updateParameters(); }
     void process(juce::AudioBuffer<float>& buffer) override;
+    double getMemorySeconds() const override;
+    double getDecaySeconds() const override;
 
 private:
     struct AllpassStage {
-        std::vector<float> delayLine;
-        int writePos = 0;
-        int delayLength = 0;
+        MaskedDelayLine<float> delayLine;
+        int delayLength = 1;
         float feedback = 0.4f;
         
-        void prepare(int maxDelaySamples, int delay, double sampleRate) {
-            delayLength = static_cast<int>(delay * sampleRate / 1000.0);  // delay in ms
-            delayLine.resize(juce::jmax(maxDelaySamples, delayLength * 2));
-            std::fill(delayLine.begin(), delayLine.end(), 0.0f);
-            writePos = 0;
+        void prepare(int delay, double sampleRate, DelayArena::Region& memory) {
+            delayLength = juce::jmax(1, static_cast<int>(delay * sampleRate / 1000.0));  // delay in ms
+            delayLine.prepare(delayLength, 0, memory);  // Fixed length
         }
         
         float process(float input) {
-            int readPos = (writePos - delayLength + static_cast<int>(delayLine.size())) % static_cast<int>(delayLine.size());
-            float delayed = delayLine[readPos];
+            float delayed = delayLine.read(delayLength);
             float output = delayed - feedback * input;
-            delayLine[writePos] = input + feedback * output;
-            writePos = (writePos + 1) % static_cast<int>(delayLine.size());
+            delayLine.push(input + feedback * output);
             return output;
         }
         
@@ -37,19 +38,15 @@ private:
     };
     
     struct DelayTank {
-        std::vector<float> delayLine;
-        int writePos = 0;
+        MaskedDelayLine<float> delayLine;
         int baseDelaySamples = 0;
         float feedbackGain = 0.7f;
         float dampingCoeff = 0.0f;
         float lastSample = 0.0f;  // For simple LP damping
         
-        void prepare(int delayMs, double sampleRate) {
+        void prepare(int delayMs, double sampleRate, DelayArena::Region& memory) {
             baseDelaySamples = static_cast<int>(delayMs * sampleRate / 1000.0);
-            int bufferSize = static_cast<int>(sampleRate * 0.6);  // 600ms max
-            delayLine.resize(bufferSize);
-            std::fill(delayLine.begin(), delayLine.end(), 0.0f);
-            writePos = 0;
+            delayLine.prepare(EngineLimits::getMaxDelaySamples(baseDelaySamples), 0, memory);
             lastSample = 0.0f;
         }
         
@@ -57,31 +54,34 @@ private:
             // Update damping (simple 1-pole LP)
             dampingCoeff = juce::jlimit(0.0f, 0.95f, damping);
             
-            // Calculate scaled delay
-            int delaySamples = static_cast<int>(baseDelaySamples * timeScale);
-            delaySamples = juce::jlimit(1, static_cast<int>(delayLine.size()) - 1, delaySamples);
+            // Calculate scaled (fractional) delay
+            const float delaySamples = juce::jlimit(2.0f, static_cast<float>(delayLine.getMaxDelay() - 2),
+                                                    baseDelaySamples * timeScale);
             
-            // Read from delay
-            int readPos = (writePos - delaySamples + static_cast<int>(delayLine.size())) % static_cast<int>(delayLine.size());
-            float output = delayLine[readPos];
+            // Read from delay, interpolated so modulation and Time changes glide
+            float output = delayLine.readFractional<DelayInterpolation::lagrange3>(delaySamples);
             
             // Apply damping (simple 1-pole LP filter)
             lastSample = output * (1.0f - dampingCoeff) + lastSample * dampingCoeff;
             output = lastSample;
             
             // Write feedback
-            delayLine[writePos] = input + output * feedbackGain;
-            writePos = (writePos + 1) % static_cast<int>(delayLine.size());
+            delayLine.push(input + output * feedbackGain);
             
             return output;
         }
     };
     
+    // Places every line in `memory` (or only counts, for getDelayMemorySize())
+    void layoutDelays(double sampleRate, DelayArena::Region& memory);
     void updateParameters();
     float applyDrip(float input, float amount);
     
     EngineParams params;
     double sampleRate = 48000.0;
+    DelayArena::Region delayMemory;
+    DelayArena ownDelayMemory;  // Only when no region was set
+    const LfoBank* lfo = nullptr;
     
     // Dispersive allpass ladder (6 stages)
     static constexpr int numAPStages = 6;
@@ -93,9 +93,6 @@ private:
     std::array<DelayTank, numTanks> tanks;
     std::array<int, numTanks> tankDelaysMs = { 250, 300 };  // Different lengths for stereo spread
     
-    // Modulation for optional movement
-    float modPhase = 0.0f;
-    
     // Drip effect
     float dripAmount = 0.0f;
 };
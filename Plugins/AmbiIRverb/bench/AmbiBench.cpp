@@ -0,0 +1,568 @@
+// ambiverb-bench: cost of every engine, chain stage and the full processBlock, as JSON.
+//
+//   ambiverb-bench [--out results.json] [--label name] [--filter text] [--quick]
+//                  [--repeats N] [--min-time seconds]
+//                  [--baseline old.json] [--tolerance percent]
+//
+// Sweeps (--quick keeps 48 kHz, blocks of 64 and 512 and IRs of 1 and 5 s):
+//  - engine/*, stage/* and processBlock/*: every sample rate x block size. The IR
+//    engine plays a 2 s stereo IR here.
+//  - ir/*: every IR length x channel format x partitioning, at 48 kHz in blocks of 512
+//  - fdncore/*: the Hall/Plate FDN core on 8, 16 and 32 lines, with each instruction
+//    set this CPU supports x delay interpolation, at 96 kHz in blocks of 512. Compare
+//    an ISA against scalar, or an interpolation against none, within one run.
+// Each case is warmed up, then timed in `repeats` runs of at least min-time seconds.
+// ns/sample is per sample frame (all channels together), the median over the runs,
+// with the fastest run alongside; it includes refilling the block with noise. The
+// realtime factor is audio seconds processed per second of processing.
+//
+// With --baseline, every case also found in that file (by key) is compared; those
+// slower by more than the tolerance (default 10%) are listed and the exit code is 1.
+// Compare results from the same machine and build type only.
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "ConvoEngine.h"
+#include "SpringEngine.h"
+#include "PlateEngine.h"
+#include "RoomEngine.h"
+#include "HallEngine.h"
+#include "Diffuser.h"
+#include "OutputEQ.h"
+#include "FDNCore.h"
+#include "LfoBank.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+
+namespace
+{
+struct Options
+{
+    juce::File output;
+    juce::String label;
+    juce::String filter;
+    bool quick = false;
+    int repeats = 5;
+    double minSeconds = 0.05;
+    juce::File baseline;
+    double tolerance = 0.1;
+};
+
+const char* getInterpolationName(DelayInterpolation interpolation)
+{
+    switch (interpolation) {
+        case DelayInterpolation::none:      return "none";
+        case DelayInterpolation::linear:    return "linear";
+        case DelayInterpolation::lagrange3: return "lagrange3";
+        case DelayInterpolation::allpass:   return "allpass";
+    }
+    return "";
+}
+
+// IR channel formats, by the number of channels in the IR file. The file name starts
+// with the format's name, so "foa" files are read as B-format (decoded to stereo).
+struct IRLayout { const char* name; int irChannels; int busChannels; };
+constexpr IRLayout irLayouts[] = {
+    { "mono", 1, 2 }, { "stereo", 2, 2 }, { "trueStereo", 4, 2 }, { "foa", 4, 2 }
+};
+const char* const partitionings[] = { "uniform", "lowLatency", "hybridTail" };
+
+struct Case
+{
+    juce::String group, name;
+    double sampleRate = 48000.0;
+    int blockSize = 512;
+    int numChannels = 2;
+    // IR cases only
+    const IRLayout* layout = nullptr;
+    double irSeconds = 0.0;
+    juce::String partitioning;
+    // FDN core cases only
+    int numLines = 0;
+    FDNCore::Isa isa = FDNCore::Isa::scalar;
+    DelayInterpolation interpolation = DelayInterpolation::lagrange3;
+
+    // Identifies the case across runs
+    juce::String getKey() const
+    {
+        auto key = group + "/" + name + "/" + juce::String(static_cast<int>(sampleRate)) + "/"
+                 + juce::String(blockSize) + "/" + juce::String(numChannels) + "ch";
+        if (layout != nullptr)
+            key << "/" << layout->name << "/" << juce::String(irSeconds, 1) << "s/" << partitioning;
+        if (numLines > 0)
+            key << "/" << numLines << "lines/" << FDNCore::getIsaName(isa) << "/" << getInterpolationName(interpolation);
+        return key;
+    }
+};
+
+struct Result
+{
+    double nsPerSample = 0.0;
+    double fastestNsPerSample = 0.0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Times process() on blocks refilled from one second of noise, so in-place
+// processors always see fresh input
+template <typename Process>
+Result measure(const Case& c, const Options& options, Process&& process)
+{
+    const int noiseLength = juce::jmax(1, static_cast<int>(c.sampleRate) / c.blockSize) * c.blockSize;
+    juce::AudioBuffer<float> noise(c.numChannels, noiseLength);
+    juce::Random random(1);
+    for (int ch = 0; ch < c.numChannels; ++ch)
+        for (int i = 0; i < noiseLength; ++i)
+            noise.setSample(ch, i, 0.25f * (2.0f * random.nextFloat() - 1.0f));
+
+    juce::AudioBuffer<float> buffer(c.numChannels, c.blockSize);
+    int offset = 0;
+    auto processBlock = [&] {
+        for (int ch = 0; ch < c.numChannels; ++ch)
+            buffer.copyFrom(ch, 0, noise, ch, offset, c.blockSize);
+        process(buffer);
+        offset = (offset + c.blockSize) % noiseLength;
+    };
+
+    // Warm-up: caches, branch predictors, engines filling their delay lines
+    for (int n = 0; n < noiseLength; n += c.blockSize)
+        processBlock();
+
+    std::vector<double> runs;
+    for (int run = 0; run < options.repeats; ++run) {
+        juce::int64 numSamples = 0;
+        const auto start = Clock::now();
+        double seconds = 0.0;
+        do {
+            processBlock();
+            numSamples += c.blockSize;
+            seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        } while (seconds < options.minSeconds);
+        runs.push_back(seconds * 1.0e9 / static_cast<double>(numSamples));
+    }
+    std::sort(runs.begin(), runs.end());
+    return { runs[runs.size() / 2], runs.front() };
+}
+
+juce::dsp::ProcessSpec getSpec(const Case& c)
+{
+    return { c.sampleRate, static_cast<juce::uint32>(c.blockSize), static_cast<juce::uint32>(c.numChannels) };
+}
+
+EngineParams getEngineParams()
+{
+    EngineParams params;
+    params.modDepth = 10.0f;   // The plugin's default
+    return params;
+}
+
+// Decaying noise, written once per format/length/rate and reused (also by the IR cache)
+juce::File getIRFile(const IRLayout& layout, double seconds, double sampleRate)
+{
+    const auto folder = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("ambiverb-bench");
+    const auto file = folder.getChildFile(juce::String(layout.name) + "_" + juce::String(layout.irChannels) + "ch_"
+                                          + juce::String(seconds, 1) + "s_"
+                                          + juce::String(static_cast<int>(sampleRate)) + ".wav");
+    if (file.existsAsFile())
+        return file;
+
+    folder.createDirectory();
+    const int numSamples = static_cast<int>(seconds * sampleRate);
+    juce::AudioBuffer<float> ir(layout.irChannels, numSamples);
+    juce::Random random(static_cast<juce::int64>(layout.irChannels) * 1000 + numSamples);
+    const float decayPerSample = std::log(0.001f) / static_cast<float>(numSamples);  // -60 dB at the end
+    for (int ch = 0; ch < layout.irChannels; ++ch)
+        for (int i = 0; i < numSamples; ++i)
+            ir.setSample(ch, i, (2.0f * random.nextFloat() - 1.0f) * std::exp(decayPerSample * static_cast<float>(i)));
+
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::OutputStream> stream(file.createOutputStream());
+    std::unique_ptr<juce::AudioFormatWriter> writer(
+        stream != nullptr ? wav.createWriterFor(stream.get(), sampleRate, static_cast<unsigned int>(layout.irChannels),
+                                                32, {}, 0)
+                          : nullptr);
+    if (writer == nullptr)
+        return {};
+    stream.release();   // Owned by the writer now
+    writer->writeFromAudioSampleBuffer(ir, 0, numSamples);
+    return file;
+}
+
+std::unique_ptr<IReverbEngine> createEngine(const juce::String& name)
+{
+    if (name == "Spring") return std::make_unique<SpringEngine>();
+    if (name == "Plate")  return std::make_unique<PlateEngine>();
+    if (name == "Room")   return std::make_unique<RoomEngine>();
+    if (name == "Hall")   return std::make_unique<HallEngine>();
+    return {};
+}
+
+bool runEngine(const Case& c, const Options& options, Result& result)
+{
+    auto engine = createEngine(c.name);
+    if (engine == nullptr)
+        return false;
+    LfoBank lfo;
+    lfo.prepare(c.sampleRate, c.blockSize);
+    engine->setModulation(&lfo);
+    engine->prepare(getSpec(c));
+    const auto params = getEngineParams();
+    engine->setParams(params);
+    result = measure(c, options, [&](juce::AudioBuffer<float>& buffer) {
+        lfo.setRate(params.modRateHz);
+        lfo.process(buffer.getNumSamples());
+        engine->process(buffer);
+    });
+    return true;
+}
+
+bool runIR(const Case& c, const Options& options, Result& result)
+{
+    const auto file = getIRFile(*c.layout, c.irSeconds, c.sampleRate);
+    IRConvolutionEngine engine;
+    engine.setLowLatency(c.partitioning == "lowLatency");
+    engine.setHybridTail(c.partitioning == "hybridTail");
+    engine.prepare(getSpec(c));
+    engine.setParams(getEngineParams());
+    if (!engine.loadIRNow(file))
+        return false;
+    result = measure(c, options, [&](juce::AudioBuffer<float>& buffer) { engine.process(buffer); });
+    return true;
+}
+
+// A Hall-like network: lines of 100-500 ms, low-pass damping, slight modulation
+bool runFDNCore(const Case& c, const Options& options, Result& result)
+{
+    juce::Random random(7);
+    std::vector<float> baseDelays;
+    std::vector<int> maxDelays;
+    for (int i = 0; i < c.numLines; ++i) {
+        baseDelays.push_back((0.1f + 0.4f * random.nextFloat()) * static_cast<float>(c.sampleRate));
+        maxDelays.push_back(EngineLimits::getMaxDelaySamples(static_cast<int>(baseDelays.back())));
+    }
+
+    FDNCore core;
+    core.prepare(c.numLines, maxDelays.data());
+    core.setIsa(c.isa);
+    if (core.getIsa() != c.isa)
+        return false;
+    core.setInterpolation(c.interpolation);
+    core.setModulationDepth(0.001f);
+    for (int i = 0; i < c.numLines; ++i) {
+        core.setBaseDelay(i, baseDelays[static_cast<size_t>(i)]);
+        const auto k = juce::dsp::IIR::ArrayCoefficients<float>::makeLowPass(
+            c.sampleRate, 3000.0f + 5000.0f * static_cast<float>(i) / static_cast<float>(c.numLines), 0.5f);
+        core.setDamping(i, k[0] / k[3], k[1] / k[3], k[2] / k[3], k[4] / k[3], k[5] / k[3]);
+        core.setGains(i, 0.999f, 0.8f);
+        core.setInputGains(i, (i & 1) ? -1.0f : 1.0f, (i & 2) ? -1.0f : 1.0f);
+        core.setOutputTaps(i, (i & 4) ? -1.0f : 1.0f, (i & 8) ? -1.0f : 1.0f);
+    }
+
+    LfoBank lfo;
+    lfo.prepare(c.sampleRate, c.blockSize);
+    lfo.setRate(0.7f);
+    const std::vector<float> delayScale(static_cast<size_t>(c.blockSize), 1.0f);
+    std::vector<float> wetLeft(static_cast<size_t>(c.blockSize)), wetRight(static_cast<size_t>(c.blockSize));
+    result = measure(c, options, [&](juce::AudioBuffer<float>& buffer) {
+        const int numSamples = buffer.getNumSamples();
+        lfo.process(numSamples);
+        core.process(buffer.getReadPointer(0), buffer.getReadPointer(1), wetLeft.data(), wetRight.data(),
+                     delayScale.data(), lfo.getSine(), lfo.getCosine(), numSamples);
+        buffer.copyFrom(0, 0, wetLeft.data(), numSamples);
+        buffer.copyFrom(1, 0, wetRight.data(), numSamples);
+    });
+    return true;
+}
+
+bool runStage(const Case& c, const Options& options, Result& result)
+{
+    if (c.name == "Diffuser") {
+        Diffuser diffuser;
+        diffuser.prepare(getSpec(c));
+        diffuser.setAmount(35.0f);
+        result = measure(c, options, [&](juce::AudioBuffer<float>& buffer) { diffuser.process(buffer); });
+        return true;
+    }
+    if (c.name == "OutputEQ") {
+        OutputEQ eq;
+        eq.prepare(getSpec(c));
+        eq.setGains(2.0f, -1.5f, 3.0f);
+        result = measure(c, options, [&](juce::AudioBuffer<float>& buffer) { eq.process(buffer); });
+        return true;
+    }
+    return false;
+}
+
+bool runProcessBlock(const Case& c, const Options& options, Result& result)
+{
+    AmbiGlassConvoVerbAudioProcessor processor;
+    const int modeIndex = processor.parameters.mode->choices.indexOf(c.name);
+    if (modeIndex < 0)
+        return false;
+    processor.parameters.mode->setValueNotifyingHost(processor.parameters.mode->convertTo0to1(static_cast<float>(modeIndex)));
+    processor.setRateAndBufferSizeDetails(c.sampleRate, c.blockSize);
+    processor.prepareToPlay(c.sampleRate, c.blockSize);
+    if (c.name == "IR" && !processor.loadIRNow(getIRFile(irLayouts[1], 2.0, c.sampleRate)))
+        return false;
+
+    juce::MidiBuffer midi;
+    result = measure(c, options, [&](juce::AudioBuffer<float>& buffer) { processor.processBlock(buffer, midi); });
+    processor.releaseResources();
+    return true;
+}
+
+bool run(const Case& c, const Options& options, Result& result)
+{
+    if (c.group == "engine" && c.name == "IR") return runIR(c, options, result);
+    if (c.group == "engine") return runEngine(c, options, result);
+    if (c.group == "ir") return runIR(c, options, result);
+    if (c.group == "fdncore") return runFDNCore(c, options, result);
+    if (c.group == "stage") return runStage(c, options, result);
+    if (c.group == "processBlock") return runProcessBlock(c, options, result);
+    return false;
+}
+
+std::vector<Case> makeCases(const Options& options)
+{
+    const std::vector<double> sampleRates = options.quick ? std::vector<double> { 48000.0 }
+                                                          : std::vector<double> { 44100.0, 48000.0, 96000.0, 192000.0 };
+    const std::vector<int> blockSizes = options.quick ? std::vector<int> { 64, 512 }
+                                                      : std::vector<int> { 16, 32, 64, 128, 256, 512, 1024, 2048 };
+    const std::vector<double> irLengths = options.quick ? std::vector<double> { 1.0, 5.0 }
+                                                        : std::vector<double> { 0.5, 1.0, 2.0, 5.0, 10.0 };
+
+    std::vector<Case> cases;
+    for (const double sampleRate : sampleRates) {
+        for (const int blockSize : blockSizes) {
+            Case c;
+            c.sampleRate = sampleRate;
+            c.blockSize = blockSize;
+
+            c.group = "engine";
+            for (const char* name : { "Spring", "Plate", "Room", "Hall" }) {
+                c.name = name;
+                cases.push_back(c);
+            }
+            auto ir = c;
+            ir.name = "IR";
+            ir.layout = &irLayouts[1];
+            ir.irSeconds = 2.0;
+            ir.partitioning = "uniform";
+            cases.push_back(ir);
+
+            c.group = "stage";
+            for (const char* name : { "Diffuser", "OutputEQ" }) {
+                c.name = name;
+                cases.push_back(c);
+            }
+
+            c.group = "processBlock";
+            for (const char* name : { "IR", "Spring", "Plate", "Room", "Hall" }) {
+                c.name = name;
+                cases.push_back(c);
+            }
+        }
+    }
+
+    for (const auto& layout : irLayouts) {
+        for (const double seconds : irLengths) {
+            for (const char* partitioning : partitionings) {
+                Case c;
+                c.group = "ir";
+                c.name = "IR";
+                c.numChannels = layout.busChannels;
+                c.layout = &layout;
+                c.irSeconds = seconds;
+                c.partitioning = partitioning;
+                cases.push_back(c);
+            }
+        }
+    }
+
+    for (const int numLines : { 8, 16, 32 }) {
+        for (const auto isa : { FDNCore::Isa::scalar, FDNCore::Isa::sse2, FDNCore::Isa::avx2 }) {
+            if (isa > FDNCore::detectIsa())
+                continue;
+            for (const auto interpolation : { DelayInterpolation::none, DelayInterpolation::linear,
+                                              DelayInterpolation::lagrange3, DelayInterpolation::allpass }) {
+                Case c;
+                c.group = "fdncore";
+                c.name = "FDNCore";
+                c.sampleRate = 96000.0;
+                c.numLines = numLines;
+                c.isa = isa;
+                c.interpolation = interpolation;
+                cases.push_back(c);
+            }
+        }
+    }
+
+    if (options.filter.isNotEmpty())
+        cases.erase(std::remove_if(cases.begin(), cases.end(),
+                                   [&](const Case& c) { return !c.getKey().containsIgnoreCase(options.filter); }),
+                    cases.end());
+    return cases;
+}
+
+juce::var toJson(const Case& c, const Result& result)
+{
+    auto* object = new juce::DynamicObject();
+    object->setProperty("key", c.getKey());
+    object->setProperty("group", c.group);
+    object->setProperty("name", c.name);
+    object->setProperty("sampleRate", c.sampleRate);
+    object->setProperty("blockSize", c.blockSize);
+    object->setProperty("channels", c.numChannels);
+    if (c.layout != nullptr) {
+        object->setProperty("irFormat", juce::String(c.layout->name));
+        object->setProperty("irSeconds", c.irSeconds);
+        object->setProperty("partitioning", c.partitioning);
+    }
+    if (c.numLines > 0) {
+        object->setProperty("lines", c.numLines);
+        object->setProperty("isa", juce::String(FDNCore::getIsaName(c.isa)));
+        object->setProperty("interpolation", juce::String(getInterpolationName(c.interpolation)));
+    }
+    object->setProperty("nsPerSample", result.nsPerSample);
+    object->setProperty("fastestNsPerSample", result.fastestNsPerSample);
+    object->setProperty("realtimeFactor", 1.0e9 / (result.nsPerSample * c.sampleRate));
+    return juce::var(object);
+}
+
+juce::var getMachine(const Options& options)
+{
+    auto* object = new juce::DynamicObject();
+    object->setProperty("label", options.label);
+    object->setProperty("date", juce::Time::getCurrentTime().toISO8601(true));
+    object->setProperty("cpu", juce::SystemStats::getCpuModel());
+    object->setProperty("cores", juce::SystemStats::getNumPhysicalCpus());
+    object->setProperty("os", juce::SystemStats::getOperatingSystemName());
+#if defined(NDEBUG)
+    object->setProperty("build", "release");
+#else
+    object->setProperty("build", "debug");
+#endif
+    object->setProperty("fdnIsa", juce::String(FDNCore::getIsaName(FDNCore::detectIsa())));
+    object->setProperty("juce", juce::SystemStats::getJUCEVersion());
+    object->setProperty("repeats", options.repeats);
+    object->setProperty("minSeconds", options.minSeconds);
+    return juce::var(object);
+}
+
+// Lists the cases slower than the baseline by more than the tolerance; returns their number
+int compareWithBaseline(const juce::Array<juce::var>& results, const Options& options)
+{
+    const auto baseline = juce::JSON::parse(options.baseline);
+    const auto* baselineResults = baseline["results"].getArray();
+    if (baselineResults == nullptr) {
+        std::cerr << "cannot read baseline " << options.baseline.getFullPathName() << "\n";
+        return 1;
+    }
+
+    std::map<juce::String, double> before;
+    for (const auto& result : *baselineResults)
+        before[result["key"].toString()] = static_cast<double>(result["nsPerSample"]);
+
+    int numCompared = 0, numSlower = 0;
+    for (const auto& result : results) {
+        const auto found = before.find(result["key"].toString());
+        if (found == before.end() || found->second <= 0.0)
+            continue;
+        ++numCompared;
+        const double ratio = static_cast<double>(result["nsPerSample"]) / found->second;
+        if (ratio > 1.0 + options.tolerance) {
+            ++numSlower;
+            std::cerr << "slower: " << result["key"].toString() << "  " << juce::String(found->second, 2) << " -> "
+                      << juce::String(static_cast<double>(result["nsPerSample"]), 2) << " ns/sample (+"
+                      << juce::String((ratio - 1.0) * 100.0, 1) << "%)\n";
+        }
+    }
+    std::cerr << numSlower << " of " << numCompared << " cases slower than the baseline by more than "
+              << juce::String(options.tolerance * 100.0, 0) << "%\n";
+    return numSlower;
+}
+
+void printUsage()
+{
+    std::cerr << "usage: ambiverb-bench [--out results.json] [--label name] [--filter text] [--quick]\n"
+                 "                      [--repeats N] [--min-time seconds]\n"
+                 "                      [--baseline old.json] [--tolerance percent]\n";
+}
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juce;
+
+    Options options;
+    const auto cwd = juce::File::getCurrentWorkingDirectory();
+    for (int i = 1; i < argc; ++i) {
+        const juce::String arg(argv[i]);
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else if (arg == "--quick") {
+            options.quick = true;
+        } else if (arg.startsWith("--") && !hasValue) {
+            std::cerr << arg << " needs a value\n";
+            return 2;
+        } else if (arg == "--out") {
+            options.output = cwd.getChildFile(argv[++i]);
+        } else if (arg == "--label") {
+            options.label = argv[++i];
+        } else if (arg == "--filter") {
+            options.filter = argv[++i];
+        } else if (arg == "--repeats") {
+            options.repeats = juce::jmax(1, juce::String(argv[++i]).getIntValue());
+        } else if (arg == "--min-time") {
+            options.minSeconds = juce::jmax(0.001, juce::String(argv[++i]).getDoubleValue());
+        } else if (arg == "--baseline") {
+            options.baseline = cwd.getChildFile(argv[++i]);
+        } else if (arg == "--tolerance") {
+            options.tolerance = juce::jmax(0.0, juce::String(argv[++i]).getDoubleValue() / 100.0);
+        } else {
+            std::cerr << "unknown option " << arg << "\n";
+            printUsage();
+            return 2;
+        }
+    }
+
+    const auto cases = makeCases(options);
+    if (cases.empty()) {
+        std::cerr << "no case matches " << options.filter << "\n";
+        return 2;
+    }
+
+    juce::Array<juce::var> results;
+    int numFailed = 0;
+    for (size_t i = 0; i < cases.size(); ++i) {
+        const auto& c = cases[i];
+        Result result;
+        std::cerr << "[" << (i + 1) << "/" << cases.size() << "] " << c.getKey() << ": ";
+        if (!run(c, options, result)) {
+            ++numFailed;
+            std::cerr << "failed\n";
+            continue;
+        }
+        std::cerr << juce::String(result.nsPerSample, 2) << " ns/sample, "
+                  << juce::String(1.0e9 / (result.nsPerSample * c.sampleRate), 1) << "x realtime\n";
+        results.add(toJson(c, result));
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("schema", 1);
+    root->setProperty("machine", getMachine(options));
+    root->setProperty("results", results);
+    const auto json = juce::JSON::toString(juce::var(root));
+    if (options.output == juce::File()) {
+        std::cout << json << "\n";
+    } else if (!options.output.replaceWithText(json)) {
+        std::cerr << "cannot write " << options.output.getFullPathName() << "\n";
+        return 1;
+    }
+
+    const int numSlower = options.baseline == juce::File() ? 0 : compareWithBaseline(results, options);
+    return numFailed == 0 && numSlower == 0 ? 0 : 1;
+}
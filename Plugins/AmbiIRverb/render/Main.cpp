@@ -0,0 +1,152 @@
+// ambiverb-render: renders audio files through a preset offline, in parallel.
+//
+//   ambiverb-render --preset <file.ambipreset> --out <folder>
+//                   [--block N] [--jobs N] [--tail seconds] [--format wav|aiff]
+//                   <file or folder>...
+//
+// Folders are expanded to the .wav/.aif/.aiff files directly inside them. Each
+// worker thread owns one processor and takes the next file when it is done.
+#include <JuceHeader.h>
+#include "OfflineRenderer.h"
+#include <atomic>
+#include <iostream>
+
+namespace
+{
+void printUsage()
+{
+    std::cerr << "usage: ambiverb-render --preset <file.ambipreset> --out <folder>\n"
+                 "                       [--block N] [--jobs N] [--tail seconds] [--format wav|aiff]\n"
+                 "                       <file or folder>...\n";
+}
+
+void addInputs(const juce::File& path, juce::Array<juce::File>& inputs)
+{
+    if (path.isDirectory()) {
+        auto files = path.findChildFiles(juce::File::findFiles, false, "*.wav;*.aif;*.aiff");
+        files.sort();
+        inputs.addArray(files);
+    } else {
+        inputs.add(path);
+    }
+}
+
+// Takes files from a shared counter until none are left
+class RenderJob : public juce::ThreadPoolJob
+{
+public:
+    RenderJob(OfflineRenderer& r, const juce::Array<juce::File>& files, std::atomic<int>& next,
+              std::atomic<int>& failed, juce::CriticalSection& outputLock)
+    : juce::ThreadPoolJob("render"), renderer(r), inputs(files), nextInput(next),
+      numFailed(failed), lock(outputLock) {}
+
+    JobStatus runJob() override
+    {
+        for (int i = nextInput++; i < inputs.size() && !shouldExit(); i = nextInput++) {
+            const auto& input = inputs.getReference(i);
+            const auto start = juce::Time::getMillisecondCounterHiRes();
+            const auto error = renderer.render(input);
+            const auto seconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+
+            const juce::ScopedLock sl(lock);
+            if (error.isEmpty()) {
+                std::cout << input.getFileName() << ": done in " << juce::String(seconds, 2) << " s\n";
+            } else {
+                ++numFailed;
+                std::cerr << input.getFileName() << ": " << error << "\n";
+            }
+        }
+        return jobHasFinished;
+    }
+
+private:
+    OfflineRenderer& renderer;
+    const juce::Array<juce::File>& inputs;
+    std::atomic<int>& nextInput;
+    std::atomic<int>& numFailed;
+    juce::CriticalSection& lock;
+};
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juce;
+
+    RenderSettings settings;
+    int numJobs = juce::SystemStats::getNumCpus();
+    juce::Array<juce::File> inputs;
+    const auto cwd = juce::File::getCurrentWorkingDirectory();
+
+    for (int i = 1; i < argc; ++i) {
+        const juce::String arg(argv[i]);
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else if (arg.startsWith("--") && !hasValue) {
+            std::cerr << arg << " needs a value\n";
+            return 2;
+        } else if (arg == "--preset") {
+            settings.preset = cwd.getChildFile(argv[++i]);
+        } else if (arg == "--out") {
+            settings.outputFolder = cwd.getChildFile(argv[++i]);
+        } else if (arg == "--block") {
+            settings.blockSize = juce::String(argv[++i]).getIntValue();
+        } else if (arg == "--jobs") {
+            numJobs = juce::String(argv[++i]).getIntValue();
+        } else if (arg == "--tail") {
+            settings.tailSeconds = juce::String(argv[++i]).getDoubleValue();
+        } else if (arg == "--format") {
+            settings.format = juce::String(argv[++i]).toLowerCase();
+        } else if (arg.startsWith("--")) {
+            std::cerr << "unknown option " << arg << "\n";
+            printUsage();
+            return 2;
+        } else {
+            addInputs(cwd.getChildFile(arg), inputs);
+        }
+    }
+
+    if (settings.preset == juce::File() || settings.outputFolder == juce::File() || inputs.isEmpty()) {
+        printUsage();
+        return 2;
+    }
+    if (settings.blockSize < 1 || numJobs < 1) {
+        std::cerr << "--block and --jobs must be at least 1\n";
+        return 2;
+    }
+    if (settings.format.isNotEmpty() && settings.format != "wav" && settings.format != "aiff") {
+        std::cerr << "--format must be wav or aiff\n";
+        return 2;
+    }
+    if (!settings.outputFolder.createDirectory()) {
+        std::cerr << "cannot create " << settings.outputFolder.getFullPathName() << "\n";
+        return 1;
+    }
+
+    // Processors are created and destroyed here, on the message thread
+    numJobs = juce::jmin(numJobs, inputs.size());
+    std::vector<std::unique_ptr<OfflineRenderer>> renderers;
+    for (int i = 0; i < numJobs; ++i) {
+        auto renderer = std::make_unique<OfflineRenderer>(settings);
+        juce::String error;
+        if (!renderer->loadPreset(error)) {
+            std::cerr << error << "\n";
+            return 1;
+        }
+        renderers.push_back(std::move(renderer));
+    }
+
+    std::atomic<int> nextInput { 0 }, numFailed { 0 };
+    juce::CriticalSection outputLock;
+    {
+        juce::ThreadPool pool(numJobs);
+        for (auto& renderer : renderers)
+            pool.addJob(new RenderJob(*renderer, inputs, nextInput, numFailed, outputLock), true);
+        while (pool.getNumJobs() > 0)
+            juce::Thread::sleep(20);
+    }
+
+    std::cout << (inputs.size() - numFailed.load()) << " of " << inputs.size() << " files rendered\n";
+    return numFailed.load() == 0 ? 0 : 1;
+}
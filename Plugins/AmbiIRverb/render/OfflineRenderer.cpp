@@ -0,0 +1,96 @@
+#include "OfflineRenderer.h"
+
+OfflineRenderer::OfflineRenderer(const RenderSettings& s)
+: settings(s)
+{
+    formats.registerBasicFormats();
+}
+
+bool OfflineRenderer::loadPreset(juce::String& error)
+{
+    preset = PresetManager::loadPreset(settings.preset);
+    if (preset == nullptr) {
+        error = "Cannot read preset " + settings.preset.getFullPathName();
+        return false;
+    }
+    if (usesIR() && !juce::File(preset->irPath).existsAsFile()) {
+        error = "Preset IR not found: " + preset->irPath;
+        return false;
+    }
+    // Mode and parameters; the IR is built per file, once the sample rate is known
+    processor.loadPreset(settings.preset);
+    return true;
+}
+
+bool OfflineRenderer::usesIR() const
+{
+    return preset != nullptr && preset->mode == ReverbMode::IR && preset->irPath.isNotEmpty();
+}
+
+juce::String OfflineRenderer::getOutputExtension(const juce::File& input) const
+{
+    if (settings.format == "aiff") return ".aiff";
+    if (settings.format == "wav") return ".wav";
+    return input.getFileExtension().toLowerCase();
+}
+
+juce::String OfflineRenderer::render(const juce::File& input)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(input));
+    if (reader == nullptr)
+        return "unsupported or unreadable file";
+
+    const auto output = settings.outputFolder.getChildFile(input.getFileNameWithoutExtension() + getOutputExtension(input));
+    if (output == input)
+        return "output would overwrite the input";
+    auto* format = formats.findFormatForFileExtension(output.getFileExtension());
+    if (format == nullptr)
+        return "no writer for " + output.getFileExtension();
+
+    // Prepared per file, so the engine and IR are built at this file's sample rate
+    const double sampleRate = reader->sampleRate;
+    const int blockSize = juce::jmax(1, settings.blockSize);
+    processor.setNonRealtime(true);
+    processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+    if (usesIR() && !processor.loadIRNow(juce::File(preset->irPath)))
+        return "cannot load IR " + preset->irPath;
+
+    // prepareToPlay() has applied the preset's params to the engine (and loadIRNow()
+    // built the IR), so the tail below is this preset's
+    const int latency = processor.getLatencySamples();
+    const double tailSeconds = settings.tailSeconds >= 0.0 ? settings.tailSeconds : processor.getTailLengthSeconds();
+    const auto inputLength = reader->lengthInSamples;
+    const auto totalLength = inputLength + static_cast<juce::int64>(std::ceil(tailSeconds * sampleRate)) + latency;
+
+    output.deleteFile();
+    std::unique_ptr<juce::OutputStream> stream(output.createOutputStream());
+    if (stream == nullptr)
+        return "cannot write " + output.getFullPathName();
+    const int bits = juce::jlimit(16, 32, static_cast<int>(reader->bitsPerSample));
+    std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), sampleRate, 2,
+                                                                            bits == 16 || bits == 24 ? bits : 32, {}, 0));
+    if (writer == nullptr)
+        return "cannot write " + output.getFullPathName();
+    stream.release();   // Owned by the writer now
+
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    juce::MidiBuffer midi;
+    for (juce::int64 position = 0; position < totalLength; position += blockSize) {
+        const int numSamples = static_cast<int>(juce::jmin<juce::int64>(blockSize, totalLength - position));
+        buffer.setSize(2, numSamples, false, false, true);
+        buffer.clear();
+        if (position < inputLength) {
+            const int toRead = static_cast<int>(juce::jmin<juce::int64>(numSamples, inputLength - position));
+            reader->read(&buffer, 0, toRead, position, true, true);
+        }
+
+        processor.processBlock(buffer, midi);
+
+        // The first `latency` samples are the delay, not the render
+        const int skip = static_cast<int>(juce::jlimit<juce::int64>(0, numSamples, latency - position));
+        if (!writer->writeFromAudioSampleBuffer(buffer, skip, numSamples - skip))
+            return "write failed for " + output.getFullPathName();
+    }
+    return {};
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+// What every file of a batch is rendered with
+struct RenderSettings
+{
+    juce::File preset;              // .ambipreset
+    juce::File outputFolder;
+    int blockSize = 512;            // Block size the processor is prepared and run at
+    double tailSeconds = -1.0;      // Rendered after the input ends; < 0 uses the processor's tail length
+    juce::String format;            // "wav" or "aiff"; empty keeps each input's format
+};
+
+// Renders audio files offline through one processor instance, so each worker of a
+// batch owns one. Construct and destroy on the message thread; render() may run on
+// any single thread at a time.
+//
+// The output is always stereo (mono inputs feed both sides, wider ones only their
+// first two channels), at the input's sample rate and bit depth, latency-compensated
+// and extended by the tail.
+class OfflineRenderer
+{
+public:
+    explicit OfflineRenderer(const RenderSettings& settings);
+
+    // Reads the preset and applies it; false with a message if it cannot be used
+    bool loadPreset(juce::String& error);
+    // Renders input into the output folder under the same name; returns an error
+    // message, or an empty string on success
+    juce::String render(const juce::File& input);
+
+    // Extension of the file render() writes for input
+    juce::String getOutputExtension(const juce::File& input) const;
+
+private:
+    // IR mode with an IR file to build
+    bool usesIR() const;
+
+    RenderSettings settings;
+    std::unique_ptr<PresetData> preset;
+    AmbiGlassConvoVerbAudioProcessor processor;
+    juce::AudioFormatManager formats;
+
+    JUCE_DECLARE_NON_COPYABLE (OfflineRenderer)
+};
@@ -0,0 +1,94 @@
+// Checks the fast FDN mixing kernels against their dense matrices.
+// Integer-valued inputs keep every intermediate exactly representable (N is a
+// power of two), so there the fast and dense results must match bit for bit;
+// random inputs only differ by summation order.
+#include "FDNMixing.h"
+#include <cstdio>
+#include <random>
+
+namespace {
+    int failures = 0;
+
+    template <typename Kernel, int N>
+    void check(const char* name, bool exactScale)
+    {
+        const auto matrix = Kernel::dense();
+        std::mt19937 rng(N);
+        std::uniform_int_distribution<int> integers(-64, 64);
+        std::uniform_real_distribution<float> reals(-1.0f, 1.0f);
+
+        for (int trial = 0; trial < 200; ++trial) {
+            const bool integerInput = trial % 2 == 0;
+            std::array<float, N> in, fast, dense;
+            for (auto& v : in)
+                v = integerInput ? static_cast<float>(integers(rng)) : reals(rng);
+
+            Kernel::apply(in.data(), fast.data());
+            FDNMixing::applyDense<N>(matrix, in.data(), dense.data());
+
+            // In place must give the same result
+            auto inPlace = in;
+            Kernel::apply(inPlace.data(), inPlace.data());
+
+            for (int i = 0; i < N; ++i) {
+                const float tolerance = (integerInput && exactScale) ? 0.0f : 1.0e-5f * static_cast<float>(N);
+                if (std::abs(fast[i] - dense[i]) > tolerance || inPlace[i] != fast[i]) {
+                    std::printf("FAIL %s<%d> trial %d line %d: fast %.9g dense %.9g\n", name, N, trial, i, fast[i], dense[i]);
+                    ++failures;
+                    return;
+                }
+            }
+        }
+        std::printf("ok   %s<%d>\n", name, N);
+    }
+
+    // Both matrices must be lossless: H * H^T = I
+    template <typename Kernel, int N>
+    void checkOrthogonal(const char* name)
+    {
+        const auto m = Kernel::dense();
+        for (int i = 0; i < N; ++i)
+            for (int j = 0; j < N; ++j) {
+                double dot = 0.0;
+                for (int k = 0; k < N; ++k)
+                    dot += static_cast<double>(m[static_cast<size_t>(i)][static_cast<size_t>(k)]) * m[static_cast<size_t>(j)][static_cast<size_t>(k)];
+                if (std::abs(dot - (i == j ? 1.0 : 0.0)) > 1.0e-5) {
+                    std::printf("FAIL %s<%d> not orthogonal at (%d, %d): %g\n", name, N, i, j, dot);
+                    ++failures;
+                    return;
+                }
+            }
+    }
+}
+
+int main()
+{
+    using namespace FDNMixing;
+
+    check<Householder<4>, 4>("Householder", true);
+    check<Householder<8>, 8>("Householder", true);
+    check<Householder<16>, 16>("Householder", true);
+    check<Householder<32>, 32>("Householder", true);
+    check<Householder<64>, 64>("Householder", true);
+    checkOrthogonal<Householder<16>, 16>("Householder");
+
+    // 1/sqrt(N) is exact only for even powers of two
+    check<Hadamard<4>, 4>("Hadamard", true);
+    check<Hadamard<8>, 8>("Hadamard", false);
+    check<Hadamard<16>, 16>("Hadamard", true);
+    check<Hadamard<32>, 32>("Hadamard", false);
+    check<Hadamard<64>, 64>("Hadamard", true);
+    checkOrthogonal<Hadamard<8>, 8>("Hadamard");
+
+    // RoomEngine's original hand-written matrix
+    const Matrix<4> room {{ { 0.5f,  0.5f,  0.5f,  0.5f },
+                            { 0.5f, -0.5f,  0.5f, -0.5f },
+                            { 0.5f,  0.5f, -0.5f, -0.5f },
+                            { 0.5f, -0.5f, -0.5f,  0.5f } }};
+    if (Hadamard<4>::dense() != room) {
+        std::printf("FAIL Hadamard<4> differs from the Room matrix\n");
+        ++failures;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
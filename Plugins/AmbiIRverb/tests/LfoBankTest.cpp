@@ -0,0 +1,60 @@
+// Runs the LFO bank for ten minutes of audio at 96 kHz in uneven blocks, with a
+// rate change halfway. The quadrature sine must track a double-precision phase
+// accumulator (no amplitude or phase drift from the recursion), the offsets must
+// give the shifted sine, and the smooth random must stay in [-1, 1] without jumps.
+#include "LfoBank.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+int main()
+{
+    constexpr double sampleRate = 96000.0;
+    constexpr double pi = 3.14159265358979323846;
+    constexpr int maxBlock = 512;
+    const auto total = static_cast<long long>(600.0 * sampleRate);
+
+    LfoBank lfo;
+    lfo.prepare(sampleRate, maxBlock);
+    const auto offset = LfoBank::PhaseOffset::fromTurns(0.3);
+
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> blockSizes(1, maxBlock);
+    double phase = 0.0;
+    float rate = 0.3f;
+    double maxError = 0.0, maxOffsetError = 0.0, maxStep = 0.0;
+    float lowest = 0.0f, highest = 0.0f, previousRandom = 0.0f;
+
+    for (long long done = 0; done < total;) {
+        if (done >= total / 2)
+            rate = 5.0f;
+        lfo.setRate(rate);
+        const int block = blockSizes(rng);
+        lfo.process(block);
+
+        for (int i = 0; i < lfo.getNumSamples(); ++i) {
+            const float s = lfo.getSine()[i], c = lfo.getCosine()[i];
+            maxError = std::max({ maxError, std::abs(s - std::sin(phase)), std::abs(c - std::cos(phase)) });
+            maxOffsetError = std::max(maxOffsetError, std::abs(offset.apply(s, c) - std::sin(phase + 0.6 * pi)));
+            phase = std::fmod(phase + 2.0 * pi * rate / sampleRate, 2.0 * pi);
+
+            const float r = lfo.getRandom()[i];
+            lowest = std::min(lowest, r);
+            highest = std::max(highest, r);
+            if (done + i > 0)
+                maxStep = std::max(maxStep, static_cast<double>(std::abs(r - previousRandom)));
+            previousRandom = r;
+        }
+        done += block;
+    }
+
+    // Slope of a smoothstep over half a period at 5 Hz peaks at 1.5 * 2 * 2 * 5 / fs
+    const double stepLimit = 1.5 * 2.0 * 2.0 * 5.0 / sampleRate * 1.01;
+    const bool sineOk = maxError < 1.0e-3 && maxOffsetError < 1.0e-3;
+    const bool randomOk = lowest >= -1.0f && highest <= 1.0f && highest - lowest > 1.0f && maxStep <= stepLimit;
+    std::printf("%s sine: max error %.3g (offset %.3g)\n", sineOk ? "ok  " : "FAIL", maxError, maxOffsetError);
+    std::printf("%s random: range [%.3f, %.3f], largest step %.3g\n", randomOk ? "ok  " : "FAIL",
+                lowest, highest, maxStep);
+    return sineOk && randomOk ? 0 : 1;
+}
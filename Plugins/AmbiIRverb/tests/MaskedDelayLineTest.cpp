@@ -0,0 +1,110 @@
+// Checks MaskedDelayLine against a plain history of everything pushed: per-sample
+// reads, read-before-write spans of feedback blocks and write-then-read spans of
+// feed-forward taps, across many wraps and with block sizes that do not divide
+// the capacity (so the mirrored guard region is exercised). Fractional reads must
+// match whole-sample reads at integer delays and be exact on a ramp, which every
+// interpolator reproduces (the allpass once its state has settled).
+#include "MaskedDelayLine.h"
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+int main()
+{
+    int failures = 0;
+    auto check = [&failures](bool ok, const char* what, int delay, int block) {
+        if (!ok && failures++ < 10)
+            std::printf("FAIL %s (delay %d, block %d)\n", what, delay, block);
+    };
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+    for (int maxBlock : { 1, 7, 64, 500 }) {
+        MaskedDelayLine<float> line;
+        line.prepare(1000, maxBlock);
+        const int capacity = line.getMaxDelay() + 1;
+        if ((capacity & (capacity - 1)) != 0 || capacity <= 1000) {
+            std::printf("FAIL capacity %d\n", capacity);
+            ++failures;
+        }
+
+        std::vector<float> history;
+        auto past = [&history](int delay) { return history[history.size() - static_cast<size_t>(delay)]; };
+        std::uniform_int_distribution<int> blockSizes(1, maxBlock);
+
+        while (history.size() < 20000) {
+            const int block = blockSizes(rng);
+            std::vector<float> input(static_cast<size_t>(block));
+            for (auto& x : input) x = value(rng);
+
+            if (history.size() > 2000) {
+                // Feedback path: a span read before the block is written
+                const int delay = std::uniform_int_distribution<int>(block, line.getMaxDelay())(rng);
+                const float* span = line.readSpan(delay, block);
+                for (int k = 0; k < block; ++k)
+                    check(span[k] == history[history.size() - static_cast<size_t>(delay) + static_cast<size_t>(k)],
+                          "readSpan before write", delay, block);
+            }
+
+            if (block % 2 == 0) {
+                line.writeBlock(input.data(), block);
+                history.insert(history.end(), input.begin(), input.end());
+            } else {
+                for (float x : input) {
+                    line.push(x);
+                    history.push_back(x);
+                }
+            }
+
+            if (history.size() > 2000) {
+                // Feed-forward tap: a span of the block just written, `tap` samples late
+                const int tap = std::uniform_int_distribution<int>(0, line.getMaxDelay() - block)(rng);
+                const float* span = line.readSpan(tap + block, block);
+                for (int k = 0; k < block; ++k)
+                    check(span[k] == past(tap + block - k), "readSpan after write", tap, block);
+
+                const int delay = std::uniform_int_distribution<int>(1, line.getMaxDelay())(rng);
+                check(line.read(delay) == past(delay), "read", delay, block);
+            }
+        }
+    }
+
+    // Fractional reads of a ramp: x = 0.001 per push
+    {
+        MaskedDelayLine<float> line;
+        line.prepare(1000);
+        int pushed = 0;
+        auto push = [&] { line.push(0.001f * static_cast<float>(pushed++)); };
+        while (pushed < 3000) push();
+
+        // The value `delay` pushes ago on the ramp
+        auto expected = [&](float delay) { return 0.001f * (static_cast<float>(pushed) - delay); };
+        auto near = [](float a, float b) { return std::abs(a - b) < 1.0e-4f; };
+
+        for (int delay : { 2, 3, 100, line.getMaxDelay() - 2 }) {
+            const float d = static_cast<float>(delay);
+            check(line.readFractional<DelayInterpolation::none>(d) == line.read(delay), "none at integer delay", delay, 0);
+            check(line.readFractional<DelayInterpolation::linear>(d) == line.read(delay), "linear at integer delay", delay, 0);
+            check(line.readFractional<DelayInterpolation::lagrange3>(d) == line.read(delay), "lagrange3 at integer delay", delay, 0);
+        }
+        for (float delay : { 2.0f, 2.25f, 17.5f, 100.9f, static_cast<float>(line.getMaxDelay() - 2) }) {
+            const int d = static_cast<int>(delay);
+            check(near(line.readFractional<DelayInterpolation::linear>(delay), expected(delay)), "linear on a ramp", d, 0);
+            check(near(line.readFractional<DelayInterpolation::lagrange3>(delay), expected(delay)), "lagrange3 on a ramp", d, 0);
+
+            float state = 0.0f;
+            float y = 0.0f;
+            for (int n = 0; n < 400; ++n) {
+                y = line.readFractional<DelayInterpolation::allpass>(delay, state);
+                push();
+            }
+            // y was read before the last push
+            check(std::abs(y - (expected(delay) - 0.001f)) < 1.0e-4f, "allpass on a ramp", d, 0);
+        }
+    }
+
+    std::printf("%s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+// Renders a short burst through a Hall preset at Time 1x and 2x with OfflineRenderer.
+// The render length comes from the processor's tail right after prepareToPlay(), so
+// the preset's Time must already have reached the engine: the 2x render has to be
+// clearly longer, and both must end with the tail decayed (not cut off mid-decay).
+// Needs JUCE; built with the renderer.
+#include <JuceHeader.h>
+#include "OfflineRenderer.h"
+#include <cstdio>
+
+namespace
+{
+constexpr double sampleRate = 48000.0;
+
+bool writeBurst(const juce::File& file)
+{
+    const int numSamples = static_cast<int>(0.1 * sampleRate);
+    juce::AudioBuffer<float> burst(2, numSamples);
+    burst.clear();
+    juce::Random random(3);
+    for (int ch = 0; ch < 2; ++ch)
+        for (int i = 0; i < static_cast<int>(0.01 * sampleRate); ++i)
+            burst.setSample(ch, i, 0.5f * (2.0f * random.nextFloat() - 1.0f));
+
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::OutputStream> stream(file.createOutputStream());
+    std::unique_ptr<juce::AudioFormatWriter> writer(
+        stream != nullptr ? wav.createWriterFor(stream.get(), sampleRate, 2, 24, {}, 0) : nullptr);
+    if (writer == nullptr)
+        return false;
+    stream.release();   // Owned by the writer now
+    return writer->writeFromAudioSampleBuffer(burst, 0, numSamples);
+}
+
+bool writePreset(const juce::File& file, float rtScale)
+{
+    auto* params = new juce::DynamicObject();
+    params->setProperty("rtScale", rtScale);
+    params->setProperty("dryWet", 100.0f);
+    auto* root = new juce::DynamicObject();
+    root->setProperty("version", "1.0.0");
+    root->setProperty("name", "Long Hall");
+    root->setProperty("mode", "Hall");
+    root->setProperty("params", juce::var(params));
+    return file.replaceWithText(juce::JSON::toString(juce::var(root)));
+}
+
+struct Rendered
+{
+    juce::int64 length = 0;
+    float endLevelDb = 0.0f;   // RMS of the last 20 ms against the peak
+};
+
+bool render(const juce::File& folder, const juce::File& input, float rtScale, Rendered& result)
+{
+    RenderSettings settings;
+    settings.preset = folder.getChildFile("time" + juce::String(rtScale, 1) + ".ambipreset");
+    settings.outputFolder = folder.getChildFile("out" + juce::String(rtScale, 1));
+    if (!writePreset(settings.preset, rtScale) || !settings.outputFolder.createDirectory())
+        return false;
+
+    OfflineRenderer renderer(settings);
+    juce::String error;
+    if (!renderer.loadPreset(error) || (error = renderer.render(input)).isNotEmpty()) {
+        std::printf("render failed: %s\n", error.toRawUTF8());
+        return false;
+    }
+
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+    std::unique_ptr<juce::AudioFormatReader> reader(
+        formats.createReaderFor(settings.outputFolder.getChildFile(input.getFileName())));
+    if (reader == nullptr)
+        return false;
+    const int numSamples = static_cast<int>(reader->lengthInSamples);
+    juce::AudioBuffer<float> output(2, numSamples);
+    reader->read(&output, 0, numSamples, 0, true, true);
+
+    const int endLength = static_cast<int>(0.02 * sampleRate);
+    const float peak = output.getMagnitude(0, numSamples);
+    const float end = juce::jmax(output.getRMSLevel(0, numSamples - endLength, endLength),
+                                 output.getRMSLevel(1, numSamples - endLength, endLength));
+    result.length = reader->lengthInSamples;
+    result.endLevelDb = juce::Decibels::gainToDecibels(end / juce::jmax(peak, 1.0e-9f), -200.0f);
+    return peak > 0.0f;
+}
+}
+
+int main()
+{
+    juce::ScopedJuceInitialiser_GUI juce;
+
+    const auto folder = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("ambiverb-render-test");
+    folder.deleteRecursively();
+    folder.createDirectory();
+    const auto input = folder.getChildFile("burst.wav");
+
+    Rendered normal, doubled;
+    const bool rendered = writeBurst(input) && render(folder, input, 1.0f, normal) && render(folder, input, 2.0f, doubled);
+    folder.deleteRecursively();
+    if (!rendered) {
+        std::printf("FAIL could not render\n");
+        return 1;
+    }
+
+    // Cut at half its decay, the 2x tail would still be near -30 dB at the end
+    const bool longerOk = doubled.length > normal.length + (normal.length - static_cast<juce::int64>(0.1 * sampleRate)) / 2;
+    const bool decayedOk = normal.endLevelDb < -40.0f && doubled.endLevelDb < -40.0f;
+    std::printf("%s length: %.2f s at 1x, %.2f s at 2x\n", longerOk ? "ok  " : "FAIL",
+                normal.length / sampleRate, doubled.length / sampleRate);
+    std::printf("%s end level: %.1f dB at 1x, %.1f dB at 2x\n", decayedOk ? "ok  " : "FAIL",
+                normal.endLevelDb, doubled.endLevelDb);
+    return longerOk && decayedOk ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+// Checks PartitionedConvolver against direct time-domain convolution for the mono,
+// stereo and true-stereo path layouts, in the uniform and low-latency layouts, fed in
+// blocks that are not powers of two. The IR is long enough to reach every low-latency
+// stage size (head, 128, 512, 2048, 8192). Each case also goes through
+// writeSpectra()/readSpectra(), and the restored convolver must match the original exactly.
+// Needs JUCE.
+#include <JuceHeader.h>
+#include "PartitionedConvolver.h"
+#include "IRSpectraCache.h"
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+constexpr int irLength = 10000;
+constexpr int inputLength = 24000;
+constexpr float maxErrorDb = -80.0f;   // Relative to the reference peak
+
+struct Layout
+{
+    const char* name;
+    int numIRChannels;
+    std::vector<PartitionedConvolver::Path> paths;
+};
+
+// Decaying noise, so late partitions carry far less energy than early ones, as in a room
+juce::AudioBuffer<float> makeIR(int numChannels, juce::Random& random)
+{
+    juce::AudioBuffer<float> ir(numChannels, irLength);
+    for (int ch = 0; ch < numChannels; ++ch)
+        for (int i = 0; i < irLength; ++i)
+            ir.setSample(ch, i, (2.0f * random.nextFloat() - 1.0f) * std::exp(-4.0f * i / irLength));
+    return ir;
+}
+
+juce::AudioBuffer<float> directConvolution(const juce::AudioBuffer<float>& input, const juce::AudioBuffer<float>& ir,
+                                           const std::vector<PartitionedConvolver::Path>& paths)
+{
+    std::vector<double> sums(static_cast<size_t>(2 * inputLength), 0.0);
+    for (const auto& p : paths) {
+        const float* in = input.getReadPointer(p.input);
+        const float* taps = ir.getReadPointer(p.irChannel);
+        double* out = sums.data() + static_cast<size_t>(p.output * inputLength);
+        for (int n = 0; n < inputLength; ++n) {
+            double sum = 0.0;
+            for (int k = 0; k < juce::jmin(irLength, n + 1); ++k)
+                sum += static_cast<double>(taps[k]) * in[n - k];
+            out[n] += sum;
+        }
+    }
+
+    juce::AudioBuffer<float> result(2, inputLength);
+    for (int ch = 0; ch < 2; ++ch)
+        for (int n = 0; n < inputLength; ++n)
+            result.setSample(ch, n, static_cast<float>(sums[static_cast<size_t>(ch * inputLength + n)]));
+    return result;
+}
+
+// Processes in place, blockSize samples at a time, and returns the output with the
+// convolver's latency removed
+juce::AudioBuffer<float> render(PartitionedConvolver& convolver, const juce::AudioBuffer<float>& input, int blockSize)
+{
+    const int latency = convolver.getLatencySamples();
+    juce::AudioBuffer<float> buffer(2, inputLength + latency);
+    buffer.clear();
+    for (int ch = 0; ch < 2; ++ch)
+        buffer.copyFrom(ch, 0, input, ch, 0, inputLength);
+
+    for (int start = 0; start < buffer.getNumSamples(); start += blockSize) {
+        const int numSamples = juce::jmin(blockSize, buffer.getNumSamples() - start);
+        float* channels[] = { buffer.getWritePointer(0, start), buffer.getWritePointer(1, start) };
+        convolver.process(channels, channels, numSamples);
+    }
+
+    juce::AudioBuffer<float> output(2, inputLength);
+    for (int ch = 0; ch < 2; ++ch)
+        output.copyFrom(ch, 0, buffer, ch, latency, inputLength);
+    return output;
+}
+
+float maxDifference(const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+{
+    float difference = 0.0f;
+    for (int ch = 0; ch < 2; ++ch)
+        for (int n = 0; n < inputLength; ++n)
+            difference = juce::jmax(difference, std::abs(a.getSample(ch, n) - b.getSample(ch, n)));
+    return difference;
+}
+
+// Writes the prepared spectra and restores them into a second convolver with the same settings
+bool roundTrip(const PartitionedConvolver& built, int blockSize, bool lowLatency, PartitionedConvolver& restored)
+{
+    auto prepared = std::make_shared<PreparedSpectra>();
+    {
+        juce::MemoryOutputStream out(prepared->memory, false);
+        built.writeSpectra(out);
+    }
+    restored.prepare(blockSize, lowLatency);
+    return restored.readSpectra(prepared->getData(), prepared->getSize(), prepared);
+}
+}
+
+int main()
+{
+    juce::ScopedJuceInitialiser_GUI juce;
+    juce::Random random(7);
+
+    juce::AudioBuffer<float> input(2, inputLength);
+    for (int ch = 0; ch < 2; ++ch)
+        for (int n = 0; n < inputLength; ++n)
+            input.setSample(ch, n, 2.0f * random.nextFloat() - 1.0f);
+
+    const Layout layouts[] = {
+        { "mono", 1, PartitionedConvolver::diagonalPaths(2, true) },
+        { "stereo", 2, PartitionedConvolver::diagonalPaths(2, false) },
+        { "true-stereo", 4, PartitionedConvolver::matrixPaths(2, 2) },
+    };
+
+    bool allOk = true;
+    for (const auto& layout : layouts) {
+        const auto ir = makeIR(layout.numIRChannels, random);
+        const auto reference = directConvolution(input, ir, layout.paths);
+        const float peak = juce::jmax(reference.getMagnitude(0, 0, inputLength), reference.getMagnitude(1, 0, inputLength));
+
+        for (bool lowLatency : { false, true }) {
+            for (int blockSize : { 37, 300, 1000 }) {
+                PartitionedConvolver convolver, restored;
+                convolver.prepare(blockSize, lowLatency);
+                convolver.setImpulseResponse(ir, 2, 2, layout.paths);
+                const bool restoredOk = roundTrip(convolver, blockSize, lowLatency, restored);
+
+                const auto output = render(convolver, input, blockSize);
+                const float errorDb = juce::Decibels::gainToDecibels(maxDifference(output, reference) / peak, -200.0f);
+                const bool matchesOk = errorDb < maxErrorDb;
+                const bool identicalOk = restoredOk && maxDifference(render(restored, input, blockSize), output) == 0.0f;
+
+                std::printf("%s %-11s %-11s block %4d: error %.1f dB, latency %d\n", matchesOk ? "ok  " : "FAIL",
+                            layout.name, lowLatency ? "lowLatency" : "uniform", blockSize, errorDb,
+                            convolver.getLatencySamples());
+                std::printf("%s %-11s %-11s block %4d: %s\n", identicalOk ? "ok  " : "FAIL", layout.name,
+                            lowLatency ? "lowLatency" : "uniform", blockSize,
+                            restoredOk ? "restored spectra" : "readSpectra failed");
+                allOk = allOk && matchesOk && identicalOk;
+            }
+        }
+    }
+    return allOk ? 0 : 1;
+}